@@ -1,11 +1,15 @@
 // MinGW Builds Downloader (FLTK)
 // ------------------------------------------------------------
 // What this program does:
-//   1) Fetch GitHub releases from niXman/mingw-builds-binaries
+//   1) Fetch releases from every enabled provider (niXman, WinLibs,
+//      llvm-mingw) concurrently and merge them into one catalog
 //   2) Parse assets, infer tokens (arch/mrt/exc/crt/rt) from file names
 //   3) Let user filter + download an asset
 //   4) Optional: extract downloaded archive (zip/7z) with libarchive
 //
+// Command line (headless): see print_usage(); progress can be streamed as
+// newline-delimited JSON with --ndjson.
+//
 // Notes:
 // - FLTK UI must be updated on the UI thread; background work uses Fl::awake.
 // - Download and extraction are done in worker threads.
@@ -14,6 +18,7 @@
 #include <FL/Fl.H>
 #include <FL/Fl_Box.H>
 #include <FL/Fl_Button.H>
+#include <FL/Fl_Check_Button.H>
 #include <FL/Fl_Choice.H>
 #include <FL/Fl_Hold_Browser.H>
 #include <FL/Fl_Progress.H>
@@ -28,17 +33,52 @@
 
 #include "json.hpp" // nlohmann::json (single-header)
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <initializer_list>
 #include <filesystem>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #ifdef _WIN32
+#include <winsock2.h> // metrics endpoint; before windows.h
 #include <FL/x.H>
 #include <windows.h>
 #include <shobjidl.h> // IFileDialog
+#include <sddl.h> // owner-only ACL on the net state directory
+#include <fcntl.h> // _O_BINARY
+#include <io.h> // _setmode
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <sys/file.h> // flock
+#include <sys/socket.h>
+#include <sys/time.h> // timeval
+#include <unistd.h>
 #endif
 
 using json = nlohmann::json;
@@ -95,12 +135,79 @@ static AssetInfo parse_asset_name(const std::string &name) {
     return info;
 }
 
+// WinLibs: winlibs-x86_64-posix-seh-gcc-14.2.0-mingw-w64ucrt-12.0.0-r2.7z
+static AssetInfo parse_winlibs_asset_name(const std::string &name) {
+    AssetInfo info{};
+
+    // Arch
+    if (has_token(name, "-i686-")) info.arch = Arch::I686;
+    else if (has_token(name, "-x86_64-")) info.arch = Arch::X86_64;
+
+    // MRT
+    if (has_token(name, "-posix-")) info.mrt = MRT::Posix;
+    else if (has_token(name, "-win32-")) info.mrt = MRT::Win32;
+    else if (has_token(name, "-mcf-")) info.mrt = MRT::Mcf;
+
+    // EXC
+    if (has_token(name, "-seh-")) info.exc = EXC::Seh;
+    else if (has_token(name, "-dwarf-")) info.exc = EXC::Dwarf;
+
+    // CRT
+    if (has_token(name, "-w64ucrt-")) info.crt = CRT::Ucrt;
+    else if (has_token(name, "-w64msvcrt-")) info.crt = CRT::Msvcrt;
+
+    return info;
+}
+
+// llvm-mingw: llvm-mingw-20250305-ucrt-x86_64.zip
+// (SEH unwinding on x86_64, DWARF on i686)
+static AssetInfo parse_llvm_mingw_asset_name(const std::string &name) {
+    AssetInfo info{};
+
+    // Arch (suffix) + EXC
+    if (has_token(name, "-i686.")) {
+        info.arch = Arch::I686;
+        info.exc = EXC::Dwarf;
+    } else if (has_token(name, "-x86_64.")) {
+        info.arch = Arch::X86_64;
+        info.exc = EXC::Seh;
+    }
+
+    // CRT
+    if (has_token(name, "-ucrt-")) info.crt = CRT::Ucrt;
+    else if (has_token(name, "-msvcrt-")) info.crt = CRT::Msvcrt;
+
+    return info;
+}
+
+// MSYS2: mingw-w64-x86_64-gcc-14.2.0-3-any.pkg.tar.zst
+// (mingw64 repo is msvcrt, ucrt64 repo is ucrt; both posix threads + SEH)
+static AssetInfo parse_msys2_package_name(const std::string &name) {
+    AssetInfo info{};
+
+    if (name.rfind("mingw-w64-ucrt-x86_64-", 0) == 0) {
+        info.arch = Arch::X86_64;
+        info.crt = CRT::Ucrt;
+    } else if (name.rfind("mingw-w64-x86_64-", 0) == 0) {
+        info.arch = Arch::X86_64;
+        info.crt = CRT::Msvcrt;
+    }
+
+    if (info.arch == Arch::X86_64) {
+        info.mrt = MRT::Posix;
+        info.exc = EXC::Seh;
+    }
+
+    return info;
+}
+
 struct Filters {
     Arch arch = Arch::Any;
     MRT mrt = MRT::Any;
     EXC exc = EXC::Any;
     CRT crt = CRT::Any;
     RT rt = RT::Any;
+    std::string text; // substring of asset name (empty = any)
 };
 
 static Filters gFilters{};
@@ -109,10 +216,14 @@ struct Asset {
     std::string name;
     long long size = 0;
     std::string url;
+    std::string sha256; // hex digest, if the provider publishes one
     AssetInfo info; // parsed from `name`
+    std::string release; // "provider/tag" and date of its release, set by build_catalog_index
+    std::string published_at;
 };
 
 struct Release {
+    std::string provider; // Provider::label
     std::string tag;
     std::string published_at;
     std::vector<Asset> assets;
@@ -129,6 +240,8 @@ static Fl_Hold_Browser *gAssets = nullptr;
 static Fl_Progress *gProgress = nullptr;
 static Fl_Box *gStatus = nullptr;
 
+static bool gHeadless = false; // command-line mode: no window, no Fl::awake
+
 static std::atomic<bool> gCancel{false};
 static std::atomic<int> gLastCurlResult{0}; // stores CURLcode
 static std::atomic<double> gProgressValue{0.0}; // progress %
@@ -136,9 +249,11 @@ static std::atomic<int> gRefreshStage{0};
 // 0 = none
 // 1 = network error
 // 2 = JSON parse error
-// 3 = success (releases already in gReleases)
+// 3 = success (releases waiting in gPendingCatalog)
+static std::atomic<bool> gRefreshBusy{false};
 
 static std::atomic<bool> gDoExtract{false};
+static std::vector<std::string> gFanoutDirs; // also extract into these (same decode pass)
 static std::atomic<int> gExtractOk{0}; // 0=none, 1=ok, -1=fail
 static std::string gExtractErr;
 
@@ -153,11 +268,21 @@ static Fl_Input *gOutDirInput = nullptr;
 // UI helpers (UI thread only)
 // ============================================================
 
+static std::string gStatusText;
+static std::string gStatusEta; // appended while a job runs
+
 static void set_status(const std::string &s) {
-    gStatus->copy_label(s.c_str());
+    gStatusText = s;
+    const std::string label = gStatusEta.empty() ? s : s + "  -  " + gStatusEta;
+    gStatus->copy_label(label.c_str());
     gStatus->redraw();
 }
 
+// Fl::awake for worker threads; a no-op when there is no UI.
+static void ui_awake(Fl_Awake_Handler *cb) {
+    if (!gHeadless) Fl::awake(cb);
+}
+
 static size_t write_callback(void *contents, const size_t size, const size_t nMemB, void *user_p) {
     const size_t total = size * nMemB;
     const auto s = static_cast<std::string *>(user_p);
@@ -166,610 +291,5447 @@ static size_t write_callback(void *contents, const size_t size, const size_t nMe
 }
 
 // ============================================================
-// GitHub API (fetch + parse)
+// Local state (app data directory)
 // ============================================================
 
-std::string fetch_releases_json() {
-    CURL *curl = curl_easy_init();
-    if (!curl) return {};
-
-    std::string response;
-
-    curl_easy_setopt(curl, CURLOPT_URL,
-                     "https://api.github.com/repos/niXman/mingw-builds-binaries/releases");
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "mingw-downloader-fltk");
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-
-    const CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+// %LOCALAPPDATA%\MingwDownloader (or $MINGWDL_HOME); holds cached indexes.
+static std::filesystem::path app_data_dir() {
+    namespace fs = std::filesystem;
+    fs::path dir;
 
-    if (res != CURLE_OK)
-        return {};
+    if (const char *home = std::getenv("MINGWDL_HOME"); home && *home) {
+        dir = home;
+    } else {
+#ifdef _WIN32
+        const char *base = std::getenv("LOCALAPPDATA");
+#else
+        const char *base = std::getenv("XDG_CACHE_HOME");
+        if (!base || !*base) base = std::getenv("HOME");
+#endif
+        dir = fs::path(base && *base ? base : ".") / "MingwDownloader";
+    }
 
-    return response;
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    return dir;
 }
 
-// ============================================================
-static bool parse_releases(const std::string &data) {
-    gReleases.clear();
-
-    try {
-        json j = json::parse(data);
-
-        for (auto &r: j) {
-            Release rel;
-            rel.tag = r.value("tag_name", "");
-            rel.published_at = r.value("published_at", "");
-
-            if (r.contains("assets") && r["assets"].is_array()) {
-                for (auto &a: r["assets"]) {
-                    Asset asset;
-                    asset.name = a.value("name", "");
-                    asset.size = a.value("size", 0LL);
-                    asset.url = a.value("browser_download_url", "");
-                    asset.info = parse_asset_name(asset.name);
+static FILE *open_file(const std::string &path, const char *mode) {
+    FILE *fp = nullptr;
+#ifdef _MSC_VER
+    if (fopen_s(&fp, path.c_str(), mode) != 0) return nullptr;
+#else
+    fp = fopen(path.c_str(), mode);
+#endif
+    return fp;
+}
 
-                    if (!asset.name.empty())
-                        rel.assets.push_back(std::move(asset));
-                }
-            }
+static bool read_file(const std::filesystem::path &path, std::string &out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
 
-            if (!rel.tag.empty())
-                gReleases.push_back(std::move(rel));
+// Write to a temporary sibling and rename, so readers never see a torn file.
+// The temporary name is unique per process and call: other threads or
+// processes writing the same file (shared cache, two windows) must not
+// truncate each other's half-written copy. The last rename wins.
+static bool write_file_atomic(const std::filesystem::path &path, const std::string_view data) {
+    namespace fs = std::filesystem;
+    static std::atomic<unsigned> counter{0};
+#ifdef _WIN32
+    const unsigned long pid = GetCurrentProcessId();
+#else
+    const unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+    const fs::path tmp = path.string() + "." + std::to_string(pid) + "." + std::to_string(++counter) + ".tmp";
+    std::error_code ec;
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            out.close();
+            fs::remove(tmp, ec);
+            return false;
         }
-    } catch (...) {
-        return false;
     }
+    fs::rename(tmp, path, ec);
+    if (ec) fs::remove(tmp, ec);
+    return !ec;
+}
 
-    return true;
+static std::string format_iso_utc(const std::time_t t) {
+    std::tm tm{};
+#ifdef _WIN32
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    return buf;
 }
 
 // ============================================================
-// Filtering UI
+// Structured log (per-thread rings, background writer)
 // ============================================================
 
-static Fl_Choice *gArch = nullptr;
-static Fl_Choice *gMrt = nullptr;
-static Fl_Choice *gExc = nullptr;
-static Fl_Choice *gCrt = nullptr;
-static Fl_Choice *gRt = nullptr;
-
-static std::vector<int> gAssetIndexMap; // list row -> release.assets[index]
+// LOG_EVENT checks the level with one relaxed load before evaluating any
+// argument, so filtered-out events cost nothing. An enabled event copies its
+// typed fields into the calling thread's lock-free ring (no formatting, no
+// locks); a background thread drains all rings every kLogFlushInterval and
+// appends JSON lines to a size-rotated file. A full ring drops the event and
+// counts it rather than blocking the caller.
+
+enum class LogLevel { Trace, Debug, Info, Warn, Error, Off };
+
+static std::atomic<int> gLogLevel{static_cast<int>(LogLevel::Off)};
+
+#define LOG_EVENT(level, event, ...) \
+    do { \
+        if (static_cast<int>(level) >= gLogLevel.load(std::memory_order_relaxed)) \
+            log_event(level, event, {__VA_ARGS__}); \
+    } while (0)
+
+constexpr size_t kLogFields = 6;
+constexpr size_t kLogText = 256; // string storage per record
+constexpr size_t kLogRingSize = 1024; // records per thread (power of two)
+constexpr auto kLogFlushInterval = std::chrono::milliseconds(100);
+constexpr std::uintmax_t kLogMaxBytes = 4 * 1024 * 1024; // per file before rotating
+constexpr int kLogKeep = 3; // rotated files kept (.1 .. .3)
+
+struct LogField {
+    const char *key;
+    long long i = 0;
+    std::string_view s;
+    bool is_str = false;
+
+    LogField(const char *k, const long long v) : key(k), i(v) {}
+    LogField(const char *k, const int v) : key(k), i(v) {}
+    LogField(const char *k, const long v) : key(k), i(v) {}
+    LogField(const char *k, const unsigned v) : key(k), i(v) {}
+    LogField(const char *k, const unsigned long v) : key(k), i(static_cast<long long>(v)) {}
+    LogField(const char *k, const unsigned long long v) : key(k), i(static_cast<long long>(v)) {}
+    LogField(const char *k, const std::string_view v) : key(k), s(v), is_str(true) {}
+    LogField(const char *k, const std::string &v) : key(k), s(v), is_str(true) {}
+    LogField(const char *k, const char *v) : key(k), s(v ? v : ""), is_str(true) {}
+};
 
-template<typename T>
-static bool match_filter(T want, T got) {
-    return want == T::Any || want == got;
+// A URL as logged: without query and fragment. Signed CDN URLs carry their
+// credentials there, and logs are written to disk by default.
+static std::string_view log_url(const std::string_view url) {
+    return url.substr(0, url.find_first_of("?#"));
 }
 
-static bool asset_matches(const Asset &a) {
-    return match_filter(gFilters.arch, a.info.arch)
-           && match_filter(gFilters.mrt, a.info.mrt)
-           && match_filter(gFilters.exc, a.info.exc)
-           && match_filter(gFilters.crt, a.info.crt)
-           && match_filter(gFilters.rt, a.info.rt);
-}
+struct LogRecord {
+    long long ts_us; // system clock, microseconds since epoch
+    const char *event; // string literal
+    unsigned char level;
+    unsigned char nfields;
+    const char *keys[kLogFields];
+    long long ints[kLogFields];
+    unsigned short str_off[kLogFields];
+    unsigned short str_len[kLogFields]; // 0xFFFF = integer field
+    char text[kLogText];
+};
 
-static void rebuild_asset_list_for_release(const int r_idx) {
-    gAssets->clear();
-    gAssetIndexMap.clear();
+// Single producer (owning thread), single consumer (writer thread).
+struct LogRing {
+    LogRecord records[kLogRingSize];
+    std::atomic<size_t> head{0}; // written by producer
+    std::atomic<size_t> tail{0}; // written by consumer
+    std::atomic<unsigned long long> dropped{0};
+    int thread_no = 0;
+    std::atomic<bool> orphaned{false}; // owning thread has exited
+};
 
-    if (r_idx < 0 || r_idx >= static_cast<int>(gReleases.size()))
-        return;
+struct LogState {
+    std::mutex mu; // guards rings (registration) and writer shutdown
+    std::condition_variable cv;
+    std::vector<std::shared_ptr<LogRing> > rings;
+    int next_thread_no = 0;
+    std::thread writer;
+    bool stop = false;
+    std::filesystem::path file;
+};
 
-    const auto &rel = gReleases[r_idx];
+static LogState gLog;
 
-    for (int i = 0; i < static_cast<int>(rel.assets.size()); ++i) {
-        const auto &a = rel.assets[i];
+// Keeps this thread's ring alive for the writer after the thread exits.
+struct LogRingOwner {
+    std::shared_ptr<LogRing> ring;
 
-        if (!asset_matches(a))
-            continue;
+    ~LogRingOwner() { if (ring) ring->orphaned = true; }
+};
 
-        const double mb = static_cast<double>(a.size) / (1024.0 * 1024.0);
+static LogRing &log_thread_ring() {
+    thread_local LogRingOwner owner;
+    if (!owner.ring) {
+        owner.ring = std::make_shared<LogRing>();
+        std::lock_guard<std::mutex> lock(gLog.mu);
+        owner.ring->thread_no = ++gLog.next_thread_no;
+        gLog.rings.push_back(owner.ring);
+    }
+    return *owner.ring;
+}
 
-        char line[1024];
-        std::snprintf(line, sizeof(line),
-                      "%-68s  (%6.1f MB)",
-                      a.name.c_str(),
-                      mb);
+static void log_event(const LogLevel level, const char *event, const std::initializer_list<LogField> fields) {
+    LogRing &ring = log_thread_ring();
+    const size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= kLogRingSize) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
 
-        gAssets->add(line);
-        gAssetIndexMap.push_back(i);
+    LogRecord &rec = ring.records[head & (kLogRingSize - 1)];
+    rec.ts_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    rec.event = event;
+    rec.level = static_cast<unsigned char>(level);
+    rec.nfields = 0;
+
+    size_t used = 0;
+    for (const auto &f: fields) {
+        if (rec.nfields == kLogFields) break;
+        const size_t k = rec.nfields++;
+        rec.keys[k] = f.key;
+        if (f.is_str) {
+            const size_t n = std::min(f.s.size(), kLogText - used);
+            std::memcpy(rec.text + used, f.s.data(), n);
+            rec.str_off[k] = static_cast<unsigned short>(used);
+            rec.str_len[k] = static_cast<unsigned short>(n);
+            used += n;
+        } else {
+            rec.ints[k] = f.i;
+            rec.str_len[k] = 0xFFFF;
+        }
     }
+
+    ring.head.store(head + 1, std::memory_order_release);
 }
 
-// -------
+static const char *log_level_name(const int level) {
+    static const char *const names[] = {"trace", "debug", "info", "warn", "error"};
+    return level >= 0 && level < 5 ? names[level] : "off";
+}
 
-static void populate_release_choice() {
-    gRelease->clear();
+static LogLevel parse_log_level(const std::string &s) {
+    for (int l = 0; l < 5; ++l)
+        if (s == log_level_name(l)) return static_cast<LogLevel>(l);
+    return LogLevel::Off;
+}
 
-    for (auto &r: gReleases) {
-        std::string label = r.tag + "  (" +
-                            (r.published_at.size() >= 10 ? r.published_at.substr(0, 10) : "") + ")";
-        gRelease->add(label.c_str());
-    }
+static std::string format_log_record(const LogRecord &rec, const int threadNo) {
+    const auto secs = static_cast<std::time_t>(rec.ts_us / 1000000);
+    char ts[40];
+    std::snprintf(ts, sizeof(ts), "%.19s.%06lldZ", format_iso_utc(secs).c_str(), rec.ts_us % 1000000);
 
-    if (!gReleases.empty()) {
-        gRelease->value(0);
-        rebuild_asset_list_for_release(0);
+    nlohmann::ordered_json j = {{"ts", ts}, {"level", log_level_name(rec.level)}, {"thread", threadNo}, {"event", rec.event}};
+    for (size_t k = 0; k < rec.nfields; ++k) {
+        if (rec.str_len[k] == 0xFFFF) j[rec.keys[k]] = rec.ints[k];
+        else j[rec.keys[k]] = std::string(rec.text + rec.str_off[k], rec.str_len[k]);
     }
+    return j.dump(-1, ' ', false, nlohmann::ordered_json::error_handler_t::replace);
 }
 
-static void on_release_changed(Fl_Widget *, void *) {
-    rebuild_asset_list_for_release(gRelease->value());
+// mingwdl.log -> mingwdl.log.1 -> ... -> mingwdl.log.<kLogKeep> (dropped)
+static void log_rotate() {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const std::string base = gLog.file.string();
+    fs::remove(base + "." + std::to_string(kLogKeep), ec);
+    for (int i = kLogKeep - 1; i >= 1; --i)
+        fs::rename(base + "." + std::to_string(i), base + "." + std::to_string(i + 1), ec);
+    fs::rename(gLog.file, base + ".1", ec);
 }
 
-static void on_filters_changed(Fl_Widget *, void *) {
-    // Arch
-    switch (gArch->value()) {
-        case 0: gFilters.arch = Arch::Any;
-            break;
-        case 1: gFilters.arch = Arch::I686;
-            break;
-        case 2: gFilters.arch = Arch::X86_64;
-            break;
-        default: ;
-    }
-    // MRT
-    switch (gMrt->value()) {
-        case 0: gFilters.mrt = MRT::Any;
-            break;
-        case 1: gFilters.mrt = MRT::Posix;
-            break;
-        case 2: gFilters.mrt = MRT::Win32;
-            break;
-        case 3: gFilters.mrt = MRT::Mcf;
-            break;
-        default: ;
-    }
-    // EXC
-    switch (gExc->value()) {
-        case 0: gFilters.exc = EXC::Any;
-            break;
-        case 1: gFilters.exc = EXC::Seh;
-            break;
-        case 2: gFilters.exc = EXC::Dwarf;
-            break;
-        default: ;
-    }
-    // CRT
-    switch (gCrt->value()) {
-        case 0: gFilters.crt = CRT::Any;
-            break;
-        case 1: gFilters.crt = CRT::Ucrt;
-            break;
-        case 2: gFilters.crt = CRT::Msvcrt;
-            break;
-        default: ;
-    }
-    // RT
-    switch (gRt->value()) {
-        case 0: gFilters.rt = RT::Any;
-            break;
-        case 1: gFilters.rt = RT::V13;
-            break;
-        default: ;
+static void log_writer_loop() {
+    std::unique_lock<std::mutex> lock(gLog.mu);
+    for (;;) {
+        const bool stopping = gLog.cv.wait_for(lock, kLogFlushInterval, [] { return gLog.stop; });
+
+        std::string out;
+        for (auto it = gLog.rings.begin(); it != gLog.rings.end();) {
+            LogRing &ring = **it;
+            const size_t head = ring.head.load(std::memory_order_acquire);
+            size_t tail = ring.tail.load(std::memory_order_relaxed);
+            for (; tail != head; ++tail) {
+                out += format_log_record(ring.records[tail & (kLogRingSize - 1)], ring.thread_no);
+                out += '\n';
+            }
+            ring.tail.store(tail, std::memory_order_release);
+
+            if (const auto dropped = ring.dropped.exchange(0); dropped > 0) {
+                LogRecord rec{};
+                rec.ts_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+                rec.event = "log.dropped";
+                rec.level = static_cast<unsigned char>(LogLevel::Warn);
+                rec.nfields = 1;
+                rec.keys[0] = "count";
+                rec.ints[0] = static_cast<long long>(dropped);
+                rec.str_len[0] = 0xFFFF;
+                out += format_log_record(rec, ring.thread_no);
+                out += '\n';
+            }
+
+            // Writer owns the last reference once the thread is gone and drained.
+            if (ring.orphaned.load() && ring.head.load(std::memory_order_acquire) == tail)
+                it = gLog.rings.erase(it);
+            else
+                ++it;
+        }
+
+        if (!out.empty()) {
+            lock.unlock();
+            std::error_code ec;
+            if (std::filesystem::file_size(gLog.file, ec) > kLogMaxBytes && !ec)
+                log_rotate();
+            if (std::ofstream f(gLog.file, std::ios::binary | std::ios::app); f)
+                f.write(out.data(), static_cast<std::streamsize>(out.size()));
+            lock.lock();
+        }
+
+        if (stopping) break;
     }
+}
 
-    rebuild_asset_list_for_release(gRelease->value());
+// Default file: <app data>/logs/mingwdl.log
+static void log_start(const LogLevel level, const std::string &path) {
+    if (level == LogLevel::Off) return;
+
+    namespace fs = std::filesystem;
+    gLog.file = path.empty() ? app_data_dir() / "logs" / "mingwdl.log" : fs::path(path);
+    std::error_code ec;
+    if (gLog.file.has_parent_path()) fs::create_directories(gLog.file.parent_path(), ec);
+
+    gLog.writer = std::thread(log_writer_loop);
+    gLogLevel = static_cast<int>(level);
 }
 
-static void on_reset_filters(Fl_Widget *, void *) {
-    gFilters = Filters{};
-    gArch->value(0);
-    gMrt->value(0);
-    gExc->value(0);
-    gCrt->value(0);
-    gRt->value(0);
-    rebuild_asset_list_for_release(gRelease->value());
+static void log_stop() {
+    if (!gLog.writer.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(gLog.mu);
+        gLog.stop = true;
+    }
+    gLog.cv.notify_all();
+    gLog.writer.join();
+    gLogLevel = static_cast<int>(LogLevel::Off);
 }
 
 // ============================================================
-// Download + extraction (worker threads)
+// Metrics (OpenMetrics)
 // ============================================================
 
-static void awake_download_done(void *) {
-    if (const int res = gLastCurlResult.load(); res == CURLE_OK) set_status("Download complete.");
-    else set_status("Download failed or cancelled.");
-    gProgress->value(0);
-    gProgress->redraw();
-}
+// Counters are single relaxed atomic adds, safe to bump from any hot loop.
+// Histograms use fixed buckets; their sum is kept in microunits so it is an
+// integer add as well. The registry is rendered on demand by the exporters.
 
-static void awake_update_progress(void *) {
-    const auto progress =
-            static_cast<float>(gProgressValue.load(std::memory_order_relaxed));
+struct Counter {
+    const char *name; // family name; the sample gets "_total"
+    const char *help;
+    std::atomic<unsigned long long> value{0};
 
-    gProgress->value(progress);
-    gProgress->redraw();
-}
+    void add(const unsigned long long n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+};
 
-static void awake_update_extract_progress(void *) {
-    const int total = gExtractTotal.load(std::memory_order_relaxed);
-    const int done = gExtractDone.load(std::memory_order_relaxed);
+struct Gauge {
+    const char *name;
+    const char *help;
+    std::atomic<long long> value{0};
 
-    float percent = 0.0f;
+    void add(const long long n) { value.fetch_add(n, std::memory_order_relaxed); }
+    void set(const long long v) { value.store(v, std::memory_order_relaxed); }
+};
 
-    if (total > 0) {
-        percent = static_cast<float>(
-            (static_cast<double>(done) / static_cast<double>(total)) * 100.0
-        );
+constexpr size_t kMaxBuckets = 12;
+
+struct Histogram {
+    const char *name;
+    const char *help;
+    double bounds[kMaxBuckets]; // ascending upper bounds; unused slots = 0
+    std::atomic<unsigned long long> buckets[kMaxBuckets + 1] = {}; // last = +Inf
+    std::atomic<unsigned long long> count{0};
+    std::atomic<unsigned long long> sum_micro{0};
+
+    void observe(const double v) {
+        size_t i = 0;
+        while (i < kMaxBuckets && bounds[i] > 0.0 && v > bounds[i]) ++i;
+        if (i < kMaxBuckets && bounds[i] <= 0.0) i = kMaxBuckets;
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum_micro.fetch_add(static_cast<unsigned long long>(v * 1e6), std::memory_order_relaxed);
     }
+};
 
-    gProgress->value(percent);
-    gProgress->redraw();
-}
+struct Metrics {
+    Counter download_bytes{"mingwdl_download_bytes", "Bytes received by downloads and prefetch."};
+    Counter downloads{"mingwdl_downloads", "Completed download attempts."};
+    Counter download_failures{"mingwdl_download_failures", "Downloads that failed or were cancelled."};
+    Counter retries{"mingwdl_transfer_retries", "Transfers restarted from the original URL."};
+    Counter extract_entries{"mingwdl_extract_entries", "Archive entries extracted."};
+    Counter extract_failures{"mingwdl_extract_failures", "Extractions that failed."};
+    Counter cache_hits{"mingwdl_cache_hits", "Downloads served from a complete cached archive."};
+    Counter cache_misses{"mingwdl_cache_misses", "Cache-backed downloads that had to fetch data."};
+    Counter catalog_fetches{"mingwdl_catalog_fetches", "Catalog refreshes."};
+    Counter catalog_failures{"mingwdl_catalog_provider_failures", "Provider fetches that failed."};
+    Counter connections{"mingwdl_connections", "Connections opened (lookup and handshake paid)."};
+    Gauge active_jobs{"mingwdl_active_jobs", "Downloads and extractions in progress."};
+    Gauge extract_rate{"mingwdl_extract_entries_per_second", "Entries per second of the last extraction."};
+    Histogram transfer_seconds{
+        "mingwdl_transfer_duration_seconds", "Download duration.",
+        {0.5, 1, 2.5, 5, 10, 30, 60, 120, 300, 600}
+    };
+    Histogram extract_seconds{
+        "mingwdl_extract_duration_seconds", "Extraction duration.",
+        {0.5, 1, 2.5, 5, 10, 30, 60, 120, 300}
+    };
+    Histogram catalog_seconds{
+        "mingwdl_catalog_fetch_duration_seconds", "Catalog refresh duration.",
+        {0.1, 0.25, 0.5, 1, 2.5, 5, 10}
+    };
+    Histogram dns_seconds{
+        "mingwdl_dns_lookup_seconds", "Name lookup time of transfers that opened a connection.",
+        {0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5}
+    };
+    Histogram tls_seconds{
+        "mingwdl_tls_handshake_seconds", "TLS handshake time of transfers that opened a connection.",
+        {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1}
+    };
+    Histogram eta_error{
+        "mingwdl_eta_error_ratio", "Mean absolute ETA error of a job, relative to its duration.",
+        {0.05, 0.1, 0.2, 0.3, 0.5, 1, 2}
+    };
+};
 
-static int progress_callback(void *,
-                             const curl_off_t total, const curl_off_t now,
-                             curl_off_t, curl_off_t) {
-    if (gCancel) return 1; // abort
+static Metrics gMetrics;
 
-    if (total > 0) {
-        gProgressValue = static_cast<double>(now) / static_cast<double>(total) * 100.0;
-        Fl::awake(awake_update_progress);
-    }
-    return 0;
+static double seconds_since(const std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static void render_counter(std::string &out, const Counter &c) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "# TYPE %s counter\n# HELP %s %s\n%s_total %llu\n",
+                  c.name, c.name, c.help, c.name, c.value.load(std::memory_order_relaxed));
+    out += line;
+}
+
+static void render_gauge(std::string &out, const Gauge &g) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "# TYPE %s gauge\n# HELP %s %s\n%s %lld\n",
+                  g.name, g.name, g.help, g.name, g.value.load(std::memory_order_relaxed));
+    out += line;
+}
+
+static void render_histogram(std::string &out, const Histogram &h) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "# TYPE %s histogram\n# HELP %s %s\n", h.name, h.name, h.help);
+    out += line;
+
+    unsigned long long cumulative = 0;
+    for (size_t i = 0; i < kMaxBuckets && h.bounds[i] > 0.0; ++i) {
+        cumulative += h.buckets[i].load(std::memory_order_relaxed);
+        std::snprintf(line, sizeof(line), "%s_bucket{le=\"%g\"} %llu\n", h.name, h.bounds[i], cumulative);
+        out += line;
+    }
+    cumulative += h.buckets[kMaxBuckets].load(std::memory_order_relaxed);
+    std::snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.6f\n%s_count %llu\n",
+                  h.name, cumulative,
+                  h.name, static_cast<double>(h.sum_micro.load(std::memory_order_relaxed)) / 1e6,
+                  h.name, h.count.load(std::memory_order_relaxed));
+    out += line;
+}
+
+static std::string render_metrics() {
+    std::string out;
+    for (const Counter *c: {
+             &gMetrics.download_bytes, &gMetrics.downloads, &gMetrics.download_failures, &gMetrics.retries,
+             &gMetrics.extract_entries, &gMetrics.extract_failures, &gMetrics.cache_hits, &gMetrics.cache_misses,
+             &gMetrics.catalog_fetches, &gMetrics.catalog_failures, &gMetrics.connections
+         })
+        render_counter(out, *c);
+    render_gauge(out, gMetrics.active_jobs);
+    render_gauge(out, gMetrics.extract_rate);
+    render_histogram(out, gMetrics.transfer_seconds);
+    render_histogram(out, gMetrics.extract_seconds);
+    render_histogram(out, gMetrics.catalog_seconds);
+    render_histogram(out, gMetrics.dns_seconds);
+    render_histogram(out, gMetrics.tls_seconds);
+    render_histogram(out, gMetrics.eta_error);
+    out += "# EOF\n";
+    return out;
+}
+
+// ---- Exporters: periodic text file and/or loopback HTTP endpoint ----
+
+constexpr auto kMetricsFileInterval = std::chrono::seconds(5);
+
+struct MetricsExport {
+    std::mutex mu;
+    std::condition_variable cv;
+    bool stop = false;
+    std::string file;
+    std::thread file_worker;
+    std::thread http_worker;
+#ifdef _WIN32
+    SOCKET listener = INVALID_SOCKET;
+#else
+    int listener = -1;
+#endif
+};
+
+static MetricsExport gMetricsExport;
+
+static void metrics_file_loop() {
+    std::unique_lock<std::mutex> lock(gMetricsExport.mu);
+    for (;;) {
+        const bool stopping = gMetricsExport.cv.wait_for(lock, kMetricsFileInterval,
+                                                         [] { return gMetricsExport.stop; });
+        write_file_atomic(gMetricsExport.file, render_metrics());
+        if (stopping) break;
+    }
+}
+
+static void close_socket(const decltype(MetricsExport::listener) s) {
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
+}
+
+constexpr int kMetricsIoTimeoutMs = 2000; // per client: an idle one must not block the endpoint
+
+static void metrics_http_loop() {
+    for (;;) {
+        const auto client = accept(gMetricsExport.listener, nullptr, nullptr);
+#ifdef _WIN32
+        if (client == INVALID_SOCKET) break;
+        const DWORD timeout = kMetricsIoTimeoutMs;
+        const int sendFlags = 0;
+#else
+        if (client < 0) break;
+        const timeval timeout{kMetricsIoTimeoutMs / 1000, (kMetricsIoTimeoutMs % 1000) * 1000};
+#ifdef MSG_NOSIGNAL
+        const int sendFlags = MSG_NOSIGNAL; // a scraper hanging up must not SIGPIPE us
+#else
+        const int sendFlags = 0;
+        int yes = 1;
+        setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+#endif
+#endif
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+
+        // Any request gets the metrics; the request itself is not inspected.
+        char req[2048];
+        recv(client, req, sizeof(req), 0);
+
+        const std::string body = render_metrics();
+        const std::string resp =
+                "HTTP/1.1 200 OK\r\n"
+                "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                "Connection: close\r\n\r\n" + body;
+        for (size_t sent = 0; sent < resp.size();) {
+            const auto n = send(client, resp.data() + sent, static_cast<int>(resp.size() - sent), sendFlags);
+            if (n <= 0) break; // gone or timed out
+            sent += static_cast<size_t>(n);
+        }
+        close_socket(client);
+    }
+}
+
+// Serves http://127.0.0.1:<port>/ (loopback only).
+static bool metrics_start_http(const int port) {
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#endif
+    const auto s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#ifdef _WIN32
+    if (s == INVALID_SOCKET) return false;
+#else
+    if (s < 0) return false;
+#endif
+
+    int yes = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&yes), sizeof(yes));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<unsigned short>(port));
+
+    if (bind(s, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0 || listen(s, 8) != 0) {
+        close_socket(s);
+        return false;
+    }
+
+    gMetricsExport.listener = s;
+    gMetricsExport.http_worker = std::thread(metrics_http_loop);
+    return true;
+}
+
+static void metrics_start_file(const std::string &path) {
+    gMetricsExport.file = path;
+    gMetricsExport.file_worker = std::thread(metrics_file_loop);
+}
+
+static void metrics_stop() {
+    {
+        std::lock_guard<std::mutex> lock(gMetricsExport.mu);
+        gMetricsExport.stop = true;
+    }
+    gMetricsExport.cv.notify_all();
+    if (gMetricsExport.file_worker.joinable()) gMetricsExport.file_worker.join();
+
+    if (gMetricsExport.http_worker.joinable()) {
+#ifdef _WIN32
+        closesocket(gMetricsExport.listener); // unblocks accept()
+#else
+        shutdown(gMetricsExport.listener, SHUT_RDWR);
+        close(gMetricsExport.listener);
+#endif
+        gMetricsExport.http_worker.join();
+    }
+}
+
+// ============================================================
+// Network (shared curl state)
+// ============================================================
+
+// One share handle for every transfer in the process: DNS cache, TLS
+// sessions and live connections are reused across refreshes and downloads.
+// What can outlive the process is kept under <app data>/net: Alt-Svc and
+// HSTS caches (curl's own files), and in state.json the addresses hosts
+// resolved to and, with curl 8.12+, TLS session tickets. They are loaded by
+// net_init and saved by net_cleanup, so a new run skips the lookup and the
+// full handshake for hosts it talked to recently. Tickets are session
+// secrets: they are only kept if net/ could be made private to the user.
+static CURLSH *gCurlShare = nullptr;
+static std::mutex gCurlShareLocks[CURL_LOCK_DATA_LAST];
+
+constexpr long long kDnsReuse = 10 * 60; // s a saved address is offered to the next run
+
+struct NetState {
+    std::string altsvc; // curl cache files
+    std::string hsts;
+    curl_slist *resolve = nullptr; // "+host:port:address" from the last runs
+    std::mutex mu;
+    std::map<std::string, std::pair<std::string, long long> > dns; // "host:port" -> (address, unix time)
+    bool proxied = false; // addresses seen are the proxy's: not recorded
+    bool private_dir = false; // net/ is owner-only: TLS tickets may be stored
+    std::atomic<bool> seeded{false}; // resolve list handed to the first transfer only
+};
+
+static NetState gNet;
+
+static void share_lock(CURL *, const curl_lock_data data, curl_lock_access, void *) {
+    gCurlShareLocks[data].lock();
+}
+
+static void share_unlock(CURL *, const curl_lock_data data, void *) {
+    gCurlShareLocks[data].unlock();
+}
+
+static std::filesystem::path net_state_path() {
+    return app_data_dir() / "net" / "state.json";
+}
+
+static int hex_digit(const char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+static std::string hex_encode(const unsigned char *p, const size_t n) {
+    std::string out;
+    char byte[3];
+    for (size_t i = 0; i < n; ++i) {
+        std::snprintf(byte, sizeof(byte), "%02x", p[i]);
+        out += byte;
+    }
+    return out;
+}
+
+// False for odd lengths and non-hex characters (a damaged state.json).
+static bool hex_decode(const std::string &s, std::string &out) {
+    out.clear();
+    if (s.size() % 2) return false;
+    for (size_t i = 0; i < s.size(); i += 2) {
+        const int hi = hex_digit(s[i]), lo = hex_digit(s[i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out += static_cast<char>(hi << 4 | lo);
+    }
+    return true;
+}
+
+static CURLcode export_tls_session(CURL *, void *userptr, const char *sessionKey, const unsigned char *shmac,
+                                   const size_t shmacLen, const unsigned char *sdata, const size_t sdataLen,
+                                   const curl_off_t validUntil, int, const char *, size_t) {
+    static_cast<json *>(userptr)->push_back({
+        {"key", sessionKey ? sessionKey : ""}, {"shmac", hex_encode(shmac, shmacLen)},
+        {"data", hex_encode(sdata, sdataLen)}, {"valid_until", static_cast<long long>(validUntil)}
+    });
+    return CURLE_OK;
+}
+#endif
+
+#if LIBCURL_VERSION_NUM >= 0x075000
+// Before each request (redirects included): the address the host resolved to.
+static int net_prereq(void *clientp, char *primaryIp, char *, const int primaryPort, int) {
+    char *url = nullptr;
+    if (gNet.proxied || !primaryIp || !*primaryIp
+        || curl_easy_getinfo(static_cast<CURL *>(clientp), CURLINFO_EFFECTIVE_URL, &url) != CURLE_OK || !url)
+        return CURL_PREREQFUNC_OK;
+
+    if (CURLU *u = curl_url()) {
+        char *host = nullptr;
+        if (curl_url_set(u, CURLUPART_URL, url, 0) == CURLUE_OK
+            && curl_url_get(u, CURLUPART_HOST, &host, 0) == CURLUE_OK && host && host[0] != '[') {
+            std::lock_guard<std::mutex> lock(gNet.mu);
+            gNet.dns[std::string(host) + ":" + std::to_string(primaryPort)] = {primaryIp, std::time(nullptr)};
+        }
+        curl_free(host);
+        curl_url_cleanup(u);
+    }
+    return CURL_PREREQFUNC_OK;
+}
+#endif
+
+// Makes `dir` accessible to the current user only: mode 0700, or on Windows
+// a protected DACL granting this user full control (inherited by new files).
+static bool make_private_dir(const std::filesystem::path &dir) {
+#ifdef _WIN32
+    HANDLE token = nullptr;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token)) return false;
+    DWORD len = 0;
+    GetTokenInformation(token, TokenUser, nullptr, 0, &len);
+    std::vector<char> user(len);
+    LPWSTR sid = nullptr;
+    const bool got = len > 0 && GetTokenInformation(token, TokenUser, user.data(), len, &len)
+                     && ConvertSidToStringSidW(reinterpret_cast<TOKEN_USER *>(user.data())->User.Sid, &sid);
+    CloseHandle(token);
+    if (!got) return false;
+    const std::wstring sddl = L"D:P(A;OICI;FA;;;" + std::wstring(sid) + L")";
+    LocalFree(sid);
+    PSECURITY_DESCRIPTOR sd = nullptr;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(sddl.c_str(), SDDL_REVISION_1, &sd, nullptr))
+        return false;
+    const bool ok = SetFileSecurityW(dir.wstring().c_str(), DACL_SECURITY_INFORMATION, sd) != 0;
+    LocalFree(sd);
+    return ok;
+#else
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::permissions(dir, fs::perms::owner_all, fs::perm_options::replace, ec);
+    if (ec) return false;
+    const fs::perms p = fs::status(dir, ec).permissions();
+    return !ec && (p & (fs::perms::group_all | fs::perms::others_all)) == fs::perms::none;
+#endif
+}
+
+static void net_init() {
+    gCurlShare = curl_share_init();
+    if (!gCurlShare) return;
+
+    curl_share_setopt(gCurlShare, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(gCurlShare, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(gCurlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(gCurlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(gCurlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#if LIBCURL_VERSION_NUM >= 0x075800
+    curl_share_setopt(gCurlShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_HSTS);
+#endif
+
+    const std::filesystem::path dir = net_state_path().parent_path();
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    gNet.private_dir = make_private_dir(dir);
+    if (!gNet.private_dir) LOG_EVENT(LogLevel::Warn, "net.not_private", LogField("dir", dir.string()));
+    gNet.altsvc = (dir / "altsvc.txt").string();
+    gNet.hsts = (dir / "hsts.txt").string();
+    for (const char *v: {"https_proxy", "HTTPS_PROXY", "http_proxy", "ALL_PROXY", "all_proxy"})
+        if (const char *p = std::getenv(v); p && *p) gNet.proxied = true;
+
+    json saved;
+    if (std::string data; read_file(net_state_path(), data)) {
+        try {
+            saved = json::parse(data);
+        } catch (const std::exception &) {
+        }
+    }
+    if (!saved.is_object()) return;
+
+    // Records of the wrong shape (a damaged or hand-edited file) are skipped:
+    // json::value() throws on a type mismatch.
+    const long long now = std::time(nullptr);
+    if (const auto dns = saved.find("dns"); dns != saved.end() && dns->is_object()) {
+        for (const auto &[key, rec]: dns->items()) {
+            try {
+                const long long seen = rec.value("seen", 0LL);
+                const std::string addr = rec.value("address", "");
+                if (addr.empty() || now - seen > kDnsReuse || gNet.proxied) continue;
+                gNet.dns[key] = {addr, seen};
+                // '+': an ordinary cache entry that times out, not a pinned address
+                gNet.resolve = curl_slist_append(gNet.resolve, ("+" + key + ":" + addr).c_str());
+            } catch (const std::exception &) {
+            }
+        }
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    int restored = 0;
+    const auto tls = saved.find("tls");
+    if (CURL *curl = gNet.private_dir && tls != saved.end() && tls->is_array() ? curl_easy_init() : nullptr) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, gCurlShare);
+        for (const auto &s: *tls) {
+            std::string key, shmac, sdata;
+            try {
+                if (s.value("valid_until", 0LL) <= now) continue;
+                key = s.value("key", "");
+                if (!hex_decode(s.value("shmac", ""), shmac) || !hex_decode(s.value("data", ""), sdata)) continue;
+            } catch (const std::exception &) {
+                continue;
+            }
+            if (curl_easy_ssls_import(curl, key.empty() ? nullptr : key.c_str(),
+                                      reinterpret_cast<const unsigned char *>(shmac.data()), shmac.size(),
+                                      reinterpret_cast<const unsigned char *>(sdata.data()), sdata.size())
+                == CURLE_OK)
+                ++restored;
+        }
+        curl_easy_cleanup(curl);
+    }
+    LOG_EVENT(LogLevel::Debug, "net.restore", LogField("hosts", gNet.dns.size()), LogField("tls_sessions", restored));
+#else
+    LOG_EVENT(LogLevel::Debug, "net.restore", LogField("hosts", gNet.dns.size()));
+#endif
+}
+
+static void net_cleanup() {
+    if (gCurlShare) {
+        json state = {{"dns", json::object()}};
+        {
+            std::lock_guard<std::mutex> lock(gNet.mu);
+            for (const auto &[key, rec]: gNet.dns)
+                state["dns"][key] = {{"address", rec.first}, {"seen", rec.second}};
+        }
+#if LIBCURL_VERSION_NUM >= 0x080c00
+        state["tls"] = json::array();
+        if (CURL *curl = gNet.private_dir ? curl_easy_init() : nullptr) {
+            curl_easy_setopt(curl, CURLOPT_SHARE, gCurlShare);
+            curl_easy_ssls_export(curl, export_tls_session, &state["tls"]);
+            curl_easy_cleanup(curl);
+        }
+#endif
+        write_file_atomic(net_state_path(), state.dump(1));
+        curl_share_cleanup(gCurlShare);
+    }
+    gCurlShare = nullptr;
+    curl_slist_free_all(gNet.resolve);
+    gNet.resolve = nullptr;
+}
+
+// Common options for every easy handle we create.
+static void net_setup_easy(CURL *curl, const char *url) {
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "mingw-downloader-fltk");
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    if (!gCurlShare) return;
+
+    curl_easy_setopt(curl, CURLOPT_SHARE, gCurlShare);
+    if (gNet.resolve && !gNet.seeded.exchange(true)) curl_easy_setopt(curl, CURLOPT_RESOLVE, gNet.resolve);
+    curl_easy_setopt(curl, CURLOPT_ALTSVC, gNet.altsvc.c_str());
+    curl_easy_setopt(curl, CURLOPT_ALTSVC_CTRL, static_cast<long>(CURLALTSVC_H1 | CURLALTSVC_H2 | CURLALTSVC_H3));
+    curl_easy_setopt(curl, CURLOPT_HSTS, gNet.hsts.c_str());
+    curl_easy_setopt(curl, CURLOPT_HSTS_CTRL, static_cast<long>(CURLHSTS_ENABLE));
+#if LIBCURL_VERSION_NUM >= 0x075000
+    curl_easy_setopt(curl, CURLOPT_PREREQFUNCTION, net_prereq);
+    curl_easy_setopt(curl, CURLOPT_PREREQDATA, curl);
+#endif
+}
+
+// After a transfer that opened connections: how long the lookup, TCP
+// connect and TLS handshake took (what the saved state is meant to cut).
+static void net_note_transfer(CURL *curl) {
+    long connects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    if (connects <= 0) return;
+
+    curl_off_t dnsUs = 0, tcpUs = 0, tlsUs = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dnsUs);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &tcpUs);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tlsUs);
+    gMetrics.connections.add(static_cast<unsigned long long>(connects));
+    gMetrics.dns_seconds.observe(static_cast<double>(dnsUs) / 1e6);
+    if (tlsUs > 0) gMetrics.tls_seconds.observe(static_cast<double>(tlsUs - tcpUs) / 1e6);
+
+    char *url = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+    LOG_EVENT(LogLevel::Debug, "net.connect", LogField("url", log_url(url ? url : "")), LogField("connects", connects),
+              LogField("dns_us", static_cast<long long>(dnsUs)),
+              LogField("tcp_us", static_cast<long long>(tcpUs - dnsUs)),
+              LogField("tls_us", static_cast<long long>(tlsUs > 0 ? tlsUs - tcpUs : 0)));
+}
+
+// ============================================================
+// Providers (catalog sources)
+// ============================================================
+
+struct ProviderResponse {
+    int page = 1;
+    long status = 0;
+    std::string body;
+    std::string etag; // validators for conditional GET
+    std::string last_modified;
+};
+
+// Case-insensitive "Name: value" match (HTTP/2 sends lower-case names).
+static bool header_value(const std::string_view line, const std::string_view name, std::string &value) {
+    if (line.size() <= name.size() || line[name.size()] != ':') return false;
+    for (size_t i = 0; i < name.size(); ++i)
+        if (std::tolower(static_cast<unsigned char>(line[i])) != name[i]) return false;
+
+    std::string_view v = line.substr(name.size() + 1);
+    while (!v.empty() && (v.front() == ' ' || v.front() == '\t')) v.remove_prefix(1);
+    while (!v.empty() && (v.back() == '\r' || v.back() == '\n' || v.back() == ' ')) v.remove_suffix(1);
+    value.assign(v);
+    return true;
+}
+
+static size_t header_callback(char *buffer, const size_t size, const size_t nItems, void *user_p) {
+    const size_t total = size * nItems;
+    auto *resp = static_cast<ProviderResponse *>(user_p);
+    const std::string_view line(buffer, total);
+
+    // A new status line starts a new response (e.g. after a redirect).
+    if (line.rfind("HTTP/", 0) == 0) {
+        resp->etag.clear();
+        resp->last_modified.clear();
+    } else if (!header_value(line, "etag", resp->etag)) {
+        header_value(line, "last-modified", resp->last_modified);
+    }
+    return total;
+}
+
+struct Provider {
+    const char *id; // key used in MINGWDL_PROVIDERS
+    const char *label; // shown in the release list
+    const char *repo; // GitHub owner/repo, or MSYS2 repository name
+    int max_pages;
+
+    std::string (*page_url)(const Provider &p, int page);
+
+    AssetInfo (*parse_name)(const std::string &name);
+
+    // Appends parsed releases to `out`; sets `more` if another page should be fetched.
+    bool (*parse_page)(const Provider &p, const ProviderResponse &resp,
+                       std::vector<Release> &out, bool &more);
+
+    // Optional: add request headers (e.g. conditional GET validators).
+    void (*prepare)(const Provider &p, curl_slist *&headers);
+
+    bool enabled;
+};
+
+constexpr int kGitHubPerPage = 100;
+
+static std::string github_page_url(const Provider &p, const int page) {
+    return std::string("https://api.github.com/repos/") + p.repo +
+           "/releases?per_page=" + std::to_string(kGitHubPerPage) +
+           "&page=" + std::to_string(page);
+}
+
+static bool parse_github_releases(const Provider &p, const ProviderResponse &resp,
+                                  std::vector<Release> &out, bool &more) {
+    more = false;
+
+    try {
+        json j = json::parse(resp.body);
+        if (!j.is_array()) return false;
+
+        for (auto &r: j) {
+            Release rel;
+            rel.provider = p.label;
+            rel.tag = r.value("tag_name", "");
+            rel.published_at = r.value("published_at", "");
+
+            if (r.contains("assets") && r["assets"].is_array()) {
+                for (auto &a: r["assets"]) {
+                    Asset asset;
+                    asset.name = a.value("name", "");
+                    asset.size = a.value("size", 0LL);
+                    asset.url = a.value("browser_download_url", "");
+                    asset.info = p.parse_name(asset.name);
+                    if (const std::string digest = a.value("digest", ""); digest.rfind("sha256:", 0) == 0)
+                        asset.sha256 = digest.substr(7);
+
+                    if (!asset.name.empty())
+                        rel.assets.push_back(std::move(asset));
+                }
+            }
+
+            if (!rel.tag.empty())
+                out.push_back(std::move(rel));
+        }
+
+        more = j.size() == static_cast<size_t>(kGitHubPerPage);
+    } catch (...) {
+        return false;
+    }
+
+    return true;
+}
+
+// ---- MSYS2 pacman repository index (<repo>.db.tar.zst) ----
+
+static std::string msys2_db_url(const Provider &p, int) {
+    return std::string("https://repo.msys2.org/mingw/") + p.repo + "/" + p.repo + ".db.tar.zst";
+}
+
+static std::filesystem::path msys2_db_cache_path(const Provider &p) {
+    return app_data_dir() / (std::string("msys2-") + p.repo + ".db.tar.zst");
+}
+
+static std::filesystem::path msys2_meta_path(const Provider &p) {
+    return app_data_dir() / (std::string("msys2-") + p.repo + ".json");
+}
+
+// If-None-Match / If-Modified-Since from the last successful fetch, but only
+// while the cached db is still there to fall back on.
+static void msys2_prepare(const Provider &p, curl_slist *&headers) {
+    std::error_code ec;
+    if (!std::filesystem::exists(msys2_db_cache_path(p), ec)) return;
+
+    std::string data;
+    if (!read_file(msys2_meta_path(p), data)) return;
+
+    try {
+        const json meta = json::parse(data);
+        if (const std::string etag = meta.value("etag", ""); !etag.empty())
+            headers = curl_slist_append(headers, ("If-None-Match: " + etag).c_str());
+        if (const std::string lm = meta.value("last_modified", ""); !lm.empty())
+            headers = curl_slist_append(headers, ("If-Modified-Since: " + lm).c_str());
+    } catch (...) {
+    }
+}
+
+// Parse one pacman `desc` record ("%KEY%\nvalue\n...\n\n") into an asset.
+static void parse_pacman_desc(const std::string_view desc, Asset &asset) {
+    std::string_view key;
+    size_t pos = 0;
+
+    while (pos < desc.size()) {
+        size_t eol = desc.find('\n', pos);
+        if (eol == std::string_view::npos) eol = desc.size();
+        const std::string_view line = desc.substr(pos, eol - pos);
+        pos = eol + 1;
+
+        if (line.empty()) {
+            key = {};
+        } else if (line.size() > 2 && line.front() == '%' && line.back() == '%') {
+            key = line;
+        } else if (key == "%FILENAME%") {
+            asset.name.assign(line);
+        } else if (key == "%CSIZE%") {
+            asset.size = std::strtoll(std::string(line).c_str(), nullptr, 10);
+        } else if (key == "%SHA256SUM%") {
+            asset.sha256.assign(line);
+        }
+    }
+}
+
+// Stream-decode the tar.zst index in memory; only `*/desc` entries are read,
+// each one parsed as soon as it is decoded. Nothing touches the disk.
+static bool read_pacman_db(const Provider &p, const std::string_view db, std::vector<Asset> &out) {
+    archive *ar = archive_read_new();
+    if (!ar) return false;
+
+    archive_read_support_format_tar(ar);
+    archive_read_support_filter_all(ar);
+
+    if (archive_read_open_memory(ar, db.data(), db.size()) != ARCHIVE_OK) {
+        archive_read_free(ar);
+        return false;
+    }
+
+    const std::string base = std::string("https://repo.msys2.org/mingw/") + p.repo + "/";
+    std::string desc;
+    char buf[16384];
+
+    int r;
+    archive_entry *entry = nullptr;
+    while ((r = archive_read_next_header(ar, &entry)) == ARCHIVE_OK) {
+        const char *path = archive_entry_pathname(entry);
+        const size_t len = path ? std::strlen(path) : 0;
+        if (len < 5 || std::strcmp(path + len - 5, "/desc") != 0) {
+            archive_read_data_skip(ar);
+            continue;
+        }
+
+        desc.clear();
+        la_ssize_t n;
+        while ((n = archive_read_data(ar, buf, sizeof(buf))) > 0)
+            desc.append(buf, static_cast<size_t>(n));
+        if (n < 0) break;
+
+        Asset asset;
+        parse_pacman_desc(desc, asset);
+        if (asset.name.empty()) continue;
+
+        asset.url = base + asset.name;
+        asset.info = p.parse_name(asset.name);
+        out.push_back(std::move(asset));
+    }
+
+    const bool ok = r == ARCHIVE_EOF;
+    archive_read_free(ar);
+    return ok;
+}
+
+// 200: index the fresh db and cache it with its validators.
+// 304: index the cached copy.
+static bool parse_msys2_db(const Provider &p, const ProviderResponse &resp,
+                           std::vector<Release> &out, bool &more) {
+    more = false;
+
+    std::string cached;
+    std::string_view db = resp.body;
+    std::string lastModified = resp.last_modified;
+
+    if (resp.status == 304) {
+        if (!read_file(msys2_db_cache_path(p), cached)) return false;
+        db = cached;
+
+        std::string data;
+        if (read_file(msys2_meta_path(p), data)) {
+            try {
+                lastModified = json::parse(data).value("last_modified", "");
+            } catch (...) {
+            }
+        }
+    } else {
+        const json meta = {{"etag", resp.etag}, {"last_modified", resp.last_modified}};
+        if (write_file_atomic(msys2_db_cache_path(p), db))
+            write_file_atomic(msys2_meta_path(p), meta.dump());
+    }
+
+    Release rel;
+    rel.provider = p.label;
+    rel.tag = p.repo;
+    if (const std::time_t t = curl_getdate(lastModified.c_str(), nullptr); t > 0)
+        rel.published_at = format_iso_utc(t);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    if (!read_pacman_db(p, db, rel.assets)) return false;
+    LOG_EVENT(LogLevel::Info, "msys2.index", LogField("repo", p.repo), LogField("status", resp.status),
+              LogField("packages", rel.assets.size()),
+              LogField("ms", static_cast<long long>(seconds_since(t0) * 1000)));
+
+    out.push_back(std::move(rel));
+    return true;
+}
+
+static Provider gProviders[] = {
+    {
+        "nixman", "niXman", "niXman/mingw-builds-binaries", 3,
+        github_page_url, parse_asset_name, parse_github_releases, nullptr, true
+    },
+    {
+        "winlibs", "WinLibs", "brechtsanders/winlibs_mingw", 3,
+        github_page_url, parse_winlibs_asset_name, parse_github_releases, nullptr, true
+    },
+    {
+        "llvm-mingw", "llvm-mingw", "mstorsjo/llvm-mingw", 3,
+        github_page_url, parse_llvm_mingw_asset_name, parse_github_releases, nullptr, true
+    },
+    {
+        "msys2-mingw64", "MSYS2", "mingw64", 1,
+        msys2_db_url, parse_msys2_package_name, parse_msys2_db, msys2_prepare, true
+    },
+    {
+        "msys2-ucrt64", "MSYS2", "ucrt64", 1,
+        msys2_db_url, parse_msys2_package_name, parse_msys2_db, msys2_prepare, false
+    },
+};
+
+// MINGWDL_PROVIDERS=nixman,winlibs restricts refresh to the listed providers.
+static void load_provider_selection() {
+    const char *env = std::getenv("MINGWDL_PROVIDERS");
+    if (!env || !*env) return;
+
+    const std::string list = std::string(",") + env + ",";
+    for (auto &p: gProviders)
+        p.enabled = has_token(list, (std::string(",") + p.id + ",").c_str());
+}
+
+// ============================================================
+// Catalog (concurrent fetch + merge + index)
+// ============================================================
+
+struct CatalogResult {
+    std::vector<Release> releases;
+    std::vector<std::string> failed; // provider labels
+    bool parse_error = false;
+    bool offline = false; // no provider answered: releases from the catalog snapshot
+};
+
+// Facets are the five filter attributes. Enum values double as Fl_Choice
+// item indices (0 = Any), so a facet code is just the enum's underlying value.
+constexpr int kFacets = 5; // arch, mrt, exc, crt, rt
+constexpr int kMaxFacetValues = 4;
+
+// Per-release attribute columns: facets[f][asset] = code of asset for facet f.
+struct ReleaseFacets {
+    std::vector<unsigned char> column[kFacets];
+};
+
+struct CatalogIndex {
+    std::unordered_map<std::string, size_t> release_by_key; // "provider/tag"
+    std::unordered_map<std::string, std::pair<size_t, size_t> > asset_by_name; // -> (release, asset)
+    std::vector<ReleaseFacets> facets; // parallel to gReleases
+};
+
+static CatalogIndex gCatalogIndex;
+
+static void build_catalog_index() {
+    gCatalogIndex = CatalogIndex{};
+    gCatalogIndex.facets.resize(gReleases.size());
+
+    for (size_t r = 0; r < gReleases.size(); ++r) {
+        auto &rel = gReleases[r];
+        const std::string key = rel.provider + "/" + rel.tag;
+        gCatalogIndex.release_by_key.emplace(key, r);
+
+        auto &cols = gCatalogIndex.facets[r].column;
+        for (auto &c: cols) c.reserve(rel.assets.size());
+
+        for (size_t a = 0; a < rel.assets.size(); ++a) {
+            const auto &info = rel.assets[a].info;
+            gCatalogIndex.asset_by_name.emplace(rel.assets[a].name, std::make_pair(r, a));
+            rel.assets[a].release = key;
+            rel.assets[a].published_at = rel.published_at;
+            cols[0].push_back(static_cast<unsigned char>(info.arch));
+            cols[1].push_back(static_cast<unsigned char>(info.mrt));
+            cols[2].push_back(static_cast<unsigned char>(info.exc));
+            cols[3].push_back(static_cast<unsigned char>(info.crt));
+            cols[4].push_back(static_cast<unsigned char>(info.rt));
+        }
+    }
+}
+
+// ------ Catalog snapshot ------
+
+// <app data>/catalog.json, written by `import`: when no provider can be
+// reached the catalog comes from here, so an air-gapped machine still lists
+// the bundled releases (their archives then come from the cache).
+
+static std::filesystem::path catalog_snapshot_path() {
+    return app_data_dir() / "catalog.json";
+}
+
+static json catalog_to_json(const std::vector<Release> &releases) {
+    json out = json::array();
+    for (const auto &rel: releases) {
+        json assets = json::array();
+        for (const auto &a: rel.assets)
+            assets.push_back({{"name", a.name}, {"size", a.size}, {"url", a.url}, {"sha256", a.sha256}});
+        out.push_back({
+            {"provider", rel.provider}, {"tag", rel.tag}, {"published_at", rel.published_at},
+            {"assets", std::move(assets)}
+        });
+    }
+    return out;
+}
+
+static bool catalog_from_json(const json &j, std::vector<Release> &out) {
+    if (!j.is_array()) return false;
+    try {
+        for (const auto &r: j) {
+            Release rel;
+            rel.provider = r.value("provider", "");
+            rel.tag = r.value("tag", "");
+            rel.published_at = r.value("published_at", "");
+
+            AssetInfo (*parse)(const std::string &) = parse_asset_name;
+            for (const auto &p: gProviders)
+                if (rel.provider == p.label) {
+                    parse = p.parse_name;
+                    break;
+                }
+            for (const auto &a: r.value("assets", json::array())) {
+                Asset asset;
+                asset.name = a.value("name", "");
+                asset.size = a.value("size", 0LL);
+                asset.url = a.value("url", "");
+                asset.sha256 = a.value("sha256", "");
+                asset.info = parse(asset.name);
+                if (!asset.name.empty()) rel.assets.push_back(std::move(asset));
+            }
+            if (!rel.tag.empty()) out.push_back(std::move(rel));
+        }
+    } catch (const std::exception &) {
+        return false;
+    }
+    return true;
+}
+
+static bool load_catalog_snapshot(std::vector<Release> &out) {
+    std::string data;
+    if (!read_file(catalog_snapshot_path(), data)) return false;
+    try {
+        return catalog_from_json(json::parse(data), out);
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
+struct PageJob {
+    size_t provider = 0; // index into gProviders
+    ProviderResponse resp;
+    curl_slist *headers = nullptr;
+};
+
+// Fetch every enabled provider concurrently on one multi handle. Requests to
+// the same host (api.github.com) are multiplexed over a single HTTP/2
+// connection; further pages are queued as soon as the previous one is parsed.
+static CatalogResult fetch_catalog() {
+    CatalogResult result;
+    const auto t0 = std::chrono::steady_clock::now();
+    gMetrics.catalog_fetches.add();
+
+    constexpr size_t n = std::size(gProviders);
+    std::vector<std::vector<Release> > perProvider(n);
+    std::vector<bool> failed(n, false);
+
+    CURLM *multi = curl_multi_init();
+    if (!multi) {
+        for (const auto &p: gProviders)
+            if (p.enabled) result.failed.emplace_back(p.label);
+        return result;
+    }
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    std::list<PageJob> jobs; // stable addresses for CURLOPT_PRIVATE
+    int active = 0;
+
+    auto start_page = [&](const size_t p, const int page) {
+        PageJob &job = jobs.emplace_back();
+        job.provider = p;
+        job.resp.page = page;
+
+        CURL *curl = curl_easy_init();
+        if (!curl) {
+            failed[p] = true;
+            return;
+        }
+
+        const std::string url = gProviders[p].page_url(gProviders[p], page);
+        net_setup_easy(curl, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &job.resp.body);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &job.resp);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+        if (gProviders[p].prepare) {
+            gProviders[p].prepare(gProviders[p], job.headers);
+            if (job.headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, job.headers);
+        }
+        curl_easy_setopt(curl, CURLOPT_PRIVATE, &job);
+
+        curl_multi_add_handle(multi, curl);
+        ++active;
+    };
+
+    for (size_t p = 0; p < n; ++p)
+        if (gProviders[p].enabled) start_page(p, 1);
+
+    while (active > 0) {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        int left = 0;
+        while (const CURLMsg *msg = curl_multi_info_read(multi, &left)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            CURL *curl = msg->easy_handle;
+            const CURLcode res = msg->data.result;
+
+            char *priv = nullptr;
+            curl_easy_getinfo(curl, CURLINFO_PRIVATE, &priv);
+            auto &job = *reinterpret_cast<PageJob *>(priv);
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &job.resp.status);
+            curl_off_t totalUs = 0;
+            curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &totalUs);
+            net_note_transfer(curl);
+
+            LOG_EVENT(res == CURLE_OK && job.resp.status < 400 ? LogLevel::Info : LogLevel::Warn, "catalog.page",
+                      LogField("provider", gProviders[job.provider].id), LogField("page", job.resp.page),
+                      LogField("curl", static_cast<int>(res)), LogField("http", job.resp.status),
+                      LogField("bytes", job.resp.body.size()), LogField("us", static_cast<long long>(totalUs)));
+
+            curl_multi_remove_handle(multi, curl);
+            curl_easy_cleanup(curl);
+            curl_slist_free_all(job.headers);
+            job.headers = nullptr;
+            --active;
+
+            const Provider &prov = gProviders[job.provider];
+            bool more = false;
+            if (res != CURLE_OK || job.resp.status >= 400) {
+                failed[job.provider] = true;
+            } else if (!prov.parse_page(prov, job.resp, perProvider[job.provider], more)) {
+                failed[job.provider] = true;
+                result.parse_error = true;
+                LOG_EVENT(LogLevel::Error, "catalog.parse_failed", LogField("provider", prov.id),
+                          LogField("page", job.resp.page));
+            } else if (more && job.resp.page < prov.max_pages) {
+                start_page(job.provider, job.resp.page + 1);
+            }
+
+            job.resp.body = std::string();
+        }
+
+        if (active > 0)
+            curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+    }
+
+    curl_multi_cleanup(multi);
+    gMetrics.catalog_seconds.observe(seconds_since(t0));
+
+    for (size_t p = 0; p < n; ++p) {
+        if (failed[p]) {
+            result.failed.emplace_back(gProviders[p].label);
+            gMetrics.catalog_failures.add();
+        }
+        for (auto &rel: perProvider[p])
+            result.releases.push_back(std::move(rel));
+    }
+
+    // Newest first across providers (ISO-8601 timestamps sort lexically).
+    std::stable_sort(result.releases.begin(), result.releases.end(),
+                     [](const Release &a, const Release &b) {
+                         return a.published_at > b.published_at;
+                     });
+
+    if (result.releases.empty() && load_catalog_snapshot(result.releases) && !result.releases.empty()) {
+        result.offline = true;
+        LOG_EVENT(LogLevel::Warn, "catalog.offline", LogField("releases", result.releases.size()));
+    }
+    return result;
+}
+
+// ============================================================
+// Filtering UI
+// ============================================================
+
+static Fl_Choice *gArch = nullptr;
+static Fl_Choice *gMrt = nullptr;
+static Fl_Choice *gExc = nullptr;
+static Fl_Choice *gCrt = nullptr;
+static Fl_Choice *gRt = nullptr;
+static Fl_Input *gSearch = nullptr;
+
+static std::vector<int> gAssetIndexMap; // list row -> release.assets[index]
+
+static const char *const kFacetItems[kFacets][kMaxFacetValues] = {
+    {"Any", "i686", "x86_64"},
+    {"Any", "posix", "win32", "mcf"},
+    {"Any", "seh", "dwarf"},
+    {"Any", "ucrt", "msvcrt"},
+    {"Any", "rt_v13"},
+};
+
+// counts[f][v]: assets that would be listed if facet f were set to v with all
+// other filters unchanged (v = 0 -> facet f set to Any).
+struct FacetCounts {
+    int n[kFacets][kMaxFacetValues] = {};
+};
+
+static Fl_Choice *facet_choice(const int f) {
+    Fl_Choice *const choices[kFacets] = {gArch, gMrt, gExc, gCrt, gRt};
+    return choices[f];
+}
+
+static void update_facet_labels(const FacetCounts *counts) {
+    char label[64];
+    for (int f = 0; f < kFacets; ++f) {
+        Fl_Choice *c = facet_choice(f);
+        for (int v = 0; v < kMaxFacetValues && kFacetItems[f][v]; ++v) {
+            if (counts) std::snprintf(label, sizeof(label), "%s (%d)", kFacetItems[f][v], counts->n[f][v]);
+            else std::snprintf(label, sizeof(label), "%s", kFacetItems[f][v]);
+            c->replace(v, label);
+        }
+        c->redraw();
+    }
+}
+
+// ------ Inventory badges ------
+
+// What is on disk for each asset, filled by the inventory worker (see
+// "Inventory") and read here to badge the asset rows: the UI thread never
+// touches the filesystem for it.
+
+struct InventoryItem {
+    long long cached = -1; // complete archive in the cache (size), -1 = none
+    long long partial = -1; // .part in the cache (size)
+    bool downloaded = false; // archive in the output directory
+    std::vector<std::string> trees; // extracted / installed trees
+};
+
+static std::mutex gInventoryMu;
+static std::unordered_map<std::string, InventoryItem> gInventory; // by asset name
+static std::atomic<bool> gInventoryDirty{true}; // picked up by inventory_timer_cb
+
+static std::string inventory_badge(const Asset &a) {
+    std::lock_guard<std::mutex> lock(gInventoryMu);
+    const auto it = gInventory.find(a.name);
+    if (it == gInventory.end()) return "";
+    const InventoryItem &i = it->second;
+    if (!i.trees.empty()) return i.trees.size() > 1 ? "installed x" + std::to_string(i.trees.size()) : "installed";
+    if (i.cached >= 0) return "cached";
+    if (i.downloaded) return "downloaded";
+    if (i.partial >= 0 && a.size > 0) return "partial " + std::to_string(i.partial * 100 / a.size) + "%";
+    return "";
+}
+
+static void format_asset_row(char *line, const size_t n, const Asset &a) {
+    const double mb = static_cast<double>(a.size) / (1024.0 * 1024.0);
+    std::snprintf(line, n, "%-68s  (%6.1f MB)  %s", a.name.c_str(), mb, inventory_badge(a).c_str());
+}
+
+static void rebuild_asset_list_for_release(const int r_idx) {
+    gAssets->clear();
+    gAssetIndexMap.clear();
+
+    if (r_idx < 0 || r_idx >= static_cast<int>(gReleases.size())) {
+        update_facet_labels(nullptr);
+        return;
+    }
+
+    const auto &rel = gReleases[r_idx];
+    const auto &cols = gCatalogIndex.facets[static_cast<size_t>(r_idx)].column;
+    const int want[kFacets] = {
+        static_cast<int>(gFilters.arch), static_cast<int>(gFilters.mrt), static_cast<int>(gFilters.exc),
+        static_cast<int>(gFilters.crt), static_cast<int>(gFilters.rt)
+    };
+
+    // One pass: an asset missing no filter is listed and counted in every
+    // facet; an asset missing exactly one facet is counted only there.
+    FacetCounts counts;
+
+    for (int i = 0; i < static_cast<int>(rel.assets.size()); ++i) {
+        const auto &a = rel.assets[i];
+
+        if (!gFilters.text.empty() && !has_token(a.name, gFilters.text.c_str()))
+            continue;
+
+        int misses = 0;
+        int missed = 0;
+        for (int f = 0; f < kFacets; ++f) {
+            if (const int code = cols[f][static_cast<size_t>(i)]; want[f] != 0 && want[f] != code) {
+                ++misses;
+                missed = f;
+            }
+        }
+
+        if (misses == 1) {
+            ++counts.n[missed][0];
+            if (const int code = cols[missed][static_cast<size_t>(i)]; code != 0) ++counts.n[missed][code];
+        }
+        if (misses != 0)
+            continue;
+
+        for (int f = 0; f < kFacets; ++f) {
+            ++counts.n[f][0];
+            if (const int code = cols[f][static_cast<size_t>(i)]; code != 0) ++counts.n[f][code];
+        }
+
+        char line[1024];
+        format_asset_row(line, sizeof(line), a);
+
+        gAssets->add(line);
+        gAssetIndexMap.push_back(i);
+    }
+
+    update_facet_labels(&counts);
+    gInventoryDirty = true;
+}
+
+// -------
+
+static void populate_release_choice() {
+    gRelease->clear();
+
+    for (auto &r: gReleases) {
+        std::string label = "[" + r.provider + "] " + r.tag + "  (" +
+                            (r.published_at.size() >= 10 ? r.published_at.substr(0, 10) : "") + ")";
+        gRelease->add(label.c_str());
+    }
+
+    if (!gReleases.empty()) {
+        gRelease->value(0);
+        rebuild_asset_list_for_release(0);
+    }
+}
+
+static void on_release_changed(Fl_Widget *, void *) {
+    rebuild_asset_list_for_release(gRelease->value());
+}
+
+static void on_filters_changed(Fl_Widget *, void *) {
+    // Arch
+    switch (gArch->value()) {
+        case 0: gFilters.arch = Arch::Any;
+            break;
+        case 1: gFilters.arch = Arch::I686;
+            break;
+        case 2: gFilters.arch = Arch::X86_64;
+            break;
+        default: ;
+    }
+    // MRT
+    switch (gMrt->value()) {
+        case 0: gFilters.mrt = MRT::Any;
+            break;
+        case 1: gFilters.mrt = MRT::Posix;
+            break;
+        case 2: gFilters.mrt = MRT::Win32;
+            break;
+        case 3: gFilters.mrt = MRT::Mcf;
+            break;
+        default: ;
+    }
+    // EXC
+    switch (gExc->value()) {
+        case 0: gFilters.exc = EXC::Any;
+            break;
+        case 1: gFilters.exc = EXC::Seh;
+            break;
+        case 2: gFilters.exc = EXC::Dwarf;
+            break;
+        default: ;
+    }
+    // CRT
+    switch (gCrt->value()) {
+        case 0: gFilters.crt = CRT::Any;
+            break;
+        case 1: gFilters.crt = CRT::Ucrt;
+            break;
+        case 2: gFilters.crt = CRT::Msvcrt;
+            break;
+        default: ;
+    }
+    // RT
+    switch (gRt->value()) {
+        case 0: gFilters.rt = RT::Any;
+            break;
+        case 1: gFilters.rt = RT::V13;
+            break;
+        default: ;
+    }
+
+    rebuild_asset_list_for_release(gRelease->value());
+}
+
+static void on_search_changed(Fl_Widget *, void *) {
+    gFilters.text = gSearch->value();
+    rebuild_asset_list_for_release(gRelease->value());
+}
+
+static void on_reset_filters(Fl_Widget *, void *) {
+    gFilters = Filters{};
+    gSearch->value("");
+    gArch->value(0);
+    gMrt->value(0);
+    gExc->value(0);
+    gCrt->value(0);
+    gRt->value(0);
+    rebuild_asset_list_for_release(gRelease->value());
+}
+
+// ============================================================
+// Redirect cache
+// ============================================================
+
+// Release asset URLs answer with a 302 to a signed CDN URL. The target is
+// kept per asset URL until shortly before its signature expires and every
+// request for the asset (warm-up, download, retries, resumes, range reads)
+// goes straight there; a 403 from the target drops it and that request goes
+// back through the asset URL.
+
+constexpr auto kResolvedTtl = std::chrono::seconds(120); // when the URL carries no expiry
+constexpr auto kResolvedMaxTtl = std::chrono::hours(1);
+constexpr long long kResolvedMargin = 30; // s before the stated expiry
+
+struct ResolvedUrl {
+    std::string target;
+    std::chrono::steady_clock::time_point until;
+};
+
+static std::mutex gResolvedMu;
+static std::unordered_map<std::string, ResolvedUrl> gResolved; // asset URL -> redirect target
+
+// Seconds since 1970 of a UTC calendar time (proleptic Gregorian).
+static long long utc_seconds(const int y, const int mon, const int d, const int h, const int min, const int s) {
+    const int yy = y - (mon <= 2);
+    const int era = (yy >= 0 ? yy : yy - 399) / 400;
+    const int yoe = yy - era * 400;
+    const int doy = (153 * (mon + (mon > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    const long long days = static_cast<long long>(era) * 146097 + doe - 719468;
+    return days * 86400 + h * 3600 + min * 60 + s;
+}
+
+// Query parameter `name` of `url`, percent-decoded ("" if absent, or if it
+// has a malformed escape: the URL is then treated as carrying no expiry).
+static std::string query_param(const std::string &url, const std::string &name) {
+    const size_t q = url.find('?');
+    if (q == std::string::npos) return "";
+    for (size_t at = q + 1; at < url.size();) {
+        size_t end = url.find('&', at);
+        if (end == std::string::npos) end = url.size();
+        if (at + name.size() < end && url.compare(at, name.size(), name) == 0 && url[at + name.size()] == '=') {
+            std::string v;
+            for (size_t i = at + name.size() + 1; i < end; ++i) {
+                if (url[i] == '%') {
+                    const int hi = i + 2 < end ? hex_digit(url[i + 1]) : -1;
+                    const int lo = i + 2 < end ? hex_digit(url[i + 2]) : -1;
+                    if (hi < 0 || lo < 0) return "";
+                    v += static_cast<char>(hi << 4 | lo);
+                    i += 2;
+                } else {
+                    v += url[i];
+                }
+            }
+            return v;
+        }
+        at = end + 1;
+    }
+    return "";
+}
+
+// When a signed URL stops working (seconds since 1970), or -1 if it does not
+// say: Azure SAS "se", S3 "X-Amz-Date" + "X-Amz-Expires", CloudFront "Expires".
+static long long signed_url_expiry(const std::string &url) {
+    int y, mon, d, h, min, s;
+    if (const std::string se = query_param(url, "se");
+        std::sscanf(se.c_str(), "%d-%d-%dT%d:%d:%d", &y, &mon, &d, &h, &min, &s) == 6)
+        return utc_seconds(y, mon, d, h, min, s);
+    if (const std::string date = query_param(url, "X-Amz-Date");
+        std::sscanf(date.c_str(), "%4d%2d%2dT%2d%2d%2d", &y, &mon, &d, &h, &min, &s) == 6)
+        return utc_seconds(y, mon, d, h, min, s) + std::atoll(query_param(url, "X-Amz-Expires").c_str());
+    if (const std::string expires = query_param(url, "Expires"); !expires.empty())
+        return std::atoll(expires.c_str());
+    return -1;
+}
+
+static void remember_resolved_url(const std::string &url, const char *effective) {
+    if (url == effective) return;
+
+    auto ttl = std::chrono::duration_cast<std::chrono::steady_clock::duration>(kResolvedTtl);
+    if (const long long expiry = signed_url_expiry(effective); expiry > 0)
+        ttl = std::min<std::chrono::steady_clock::duration>(
+            std::chrono::seconds(std::max(0LL, expiry - kResolvedMargin - static_cast<long long>(std::time(nullptr)))),
+            kResolvedMaxTtl);
+
+    std::lock_guard<std::mutex> lock(gResolvedMu);
+    gResolved[url] = {effective, std::chrono::steady_clock::now() + ttl};
+    LOG_EVENT(LogLevel::Debug, "redirect.cached", LogField("url", log_url(url)),
+              LogField("ttl_s", static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(ttl).count())));
+}
+
+static void forget_resolved_url(const std::string &url) {
+    std::lock_guard<std::mutex> lock(gResolvedMu);
+    gResolved.erase(url);
+}
+
+// Cached redirect target of `url` while it is valid, else `url` itself.
+static std::string resolved_url_for(const std::string &url) {
+    std::lock_guard<std::mutex> lock(gResolvedMu);
+    if (const auto it = gResolved.find(url); it != gResolved.end()) {
+        if (std::chrono::steady_clock::now() < it->second.until) return it->second.target;
+        gResolved.erase(it);
+    }
+    return url;
+}
+
+// ============================================================
+// Speculative warm-up (asset selection)
+// ============================================================
+
+// Selecting an asset fetches its first byte in the background: this follows
+// the GitHub 302 and leaves warm connections to both hosts in the shared
+// connection cache, so the Download click starts receiving data at once.
+
+constexpr double kWarmDelay = 0.25; // seconds of stable selection before warming
+
+static std::atomic<unsigned> gWarmGen{0}; // bumped on every selection change
+
+// The body is not wanted: stop at its first chunk. "Range: 0-0" keeps it at
+// one byte, but a server that ignores Range would send the whole asset.
+static size_t warm_write_callback(void *, size_t, size_t, void *) {
+    return 0; // CURLE_WRITE_ERROR, after the redirect has been followed
+}
+
+// Aborts an in-flight warm-up as soon as the selection moves on.
+static int warm_progress_callback(void *clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    const auto gen = static_cast<unsigned>(reinterpret_cast<uintptr_t>(clientp));
+    return gen != gWarmGen.load(std::memory_order_relaxed) ? 1 : 0;
+}
+
+static void warm_up_url(const std::string &url, const unsigned gen) {
+    CURL *curl = curl_easy_init();
+    if (!curl) return;
+
+    net_setup_easy(curl, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_RANGE, "0-0");
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, warm_write_callback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, warm_progress_callback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, reinterpret_cast<void *>(static_cast<uintptr_t>(gen)));
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+    long status = 0;
+    char *effective = nullptr;
+    const CURLcode res = curl_easy_perform(curl);
+    if ((res == CURLE_OK || res == CURLE_WRITE_ERROR)
+        && curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status) == CURLE_OK
+        && (status == 200 || status == 206)
+        && curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective) == CURLE_OK && effective) {
+        remember_resolved_url(url, effective);
+    }
+    net_note_transfer(curl);
+    LOG_EVENT(LogLevel::Debug, "warmup.done", LogField("url", log_url(url)), LogField("curl", static_cast<int>(res)),
+              LogField("http", status));
+
+    curl_easy_cleanup(curl);
+}
+
+// ============================================================
+// Progress reporting (NDJSON sink)
+// ============================================================
+
+// Hot loops only store into the atomics below. A dedicated thread samples
+// them every kNdjsonInterval and writes one JSON object per line, so a slow
+// consumer can never stall a transfer or an extraction. Phase changes and
+// errors are queued as discrete events.
+
+enum class Phase { Idle, Fetch, Download, Count, Extract, Done };
+
+static const char *phase_name(const Phase p) {
+    switch (p) {
+        case Phase::Fetch: return "fetch";
+        case Phase::Download: return "download";
+        case Phase::Count: return "count";
+        case Phase::Extract: return "extract";
+        case Phase::Done: return "done";
+        default: return "idle";
+    }
+}
+
+static std::atomic<int> gPhase{0}; // Phase
+static std::atomic<long long> gXferBytes{0}; // bytes on disk for the current download
+static std::atomic<long long> gXferTotal{0}; // expected size (0 = unknown)
+static std::atomic<long long> gCountBytes{0}; // archive bytes read by the count pass
+static std::atomic<long long> gExtractBytes{0}; // uncompressed bytes written
+static std::atomic<long long> gExtractBytesTotal{0}; // from the count pass (0 = unknown)
+static std::atomic<long long> gEtaMs{-1}; // job time left (-1 = unknown)
+
+constexpr auto kNdjsonInterval = std::chrono::milliseconds(250);
+
+struct NdjsonSink {
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<std::string> queue; // pending discrete events
+    std::thread worker;
+    FILE *out = nullptr;
+    bool stop = false;
+    std::chrono::steady_clock::time_point start;
+    std::atomic<double> rate{0.0}; // bytes/s of the running phase, from the writer thread
+};
+
+static NdjsonSink gNdjson;
+
+static double ndjson_time() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - gNdjson.start).count();
+}
+
+static void ndjson_emit(json ev) {
+    if (!gNdjson.out) return;
+    ev["t"] = ndjson_time();
+    {
+        std::lock_guard<std::mutex> lock(gNdjson.mu);
+        gNdjson.queue.push_back(ev.dump());
+    }
+    gNdjson.cv.notify_one();
+}
+
+// Current counters of a download/extract phase, with the last sampled rate.
+static json progress_snapshot(const Phase phase) {
+    if (phase == Phase::Download)
+        return {
+            {"event", "progress"}, {"phase", "download"}, {"bytes", gXferBytes.load(std::memory_order_relaxed)},
+            {"total", gXferTotal.load(std::memory_order_relaxed)}, {"rate", gNdjson.rate.load()}
+        };
+    if (phase == Phase::Extract)
+        return {
+            {"event", "progress"}, {"phase", "extract"}, {"entries", gExtractDone.load(std::memory_order_relaxed)},
+            {"entries_total", gExtractTotal.load(std::memory_order_relaxed)}, {"rate", gNdjson.rate.load()}
+        };
+    return {};
+}
+
+static void ndjson_loop() {
+    long long lastBytes = -1; // downloaded, or written by extraction
+    int lastEntries = -1;
+    double lastT = 0.0;
+    double rate = 0.0; // EWMA, bytes/s
+    const auto update_rate = [&](const long long bytes, const double t) {
+        if (lastBytes >= 0 && t > lastT) {
+            const double inst = static_cast<double>(bytes - lastBytes) / (t - lastT);
+            rate = rate > 0.0 ? 0.7 * rate + 0.3 * inst : inst;
+            gNdjson.rate = rate;
+        }
+        lastBytes = bytes;
+        lastT = t;
+    };
+
+    std::unique_lock<std::mutex> lock(gNdjson.mu);
+    for (;;) {
+        gNdjson.cv.wait_for(lock, kNdjsonInterval, [] { return gNdjson.stop || !gNdjson.queue.empty(); });
+
+        std::deque<std::string> events;
+        events.swap(gNdjson.queue);
+        const bool stopping = gNdjson.stop;
+        lock.unlock();
+
+        for (const auto &e: events)
+            std::fprintf(gNdjson.out, "%s\n", e.c_str());
+
+        const auto phase = static_cast<Phase>(gPhase.load(std::memory_order_relaxed));
+        const double t = ndjson_time();
+        json ev;
+
+        if (phase == Phase::Download) {
+            const long long bytes = gXferBytes.load(std::memory_order_relaxed);
+            if (bytes != lastBytes) {
+                update_rate(bytes, t);
+                ev = progress_snapshot(phase);
+            }
+        } else if (phase == Phase::Extract) {
+            if (const int done = gExtractDone.load(std::memory_order_relaxed); done != lastEntries) {
+                lastEntries = done;
+                update_rate(gExtractBytes.load(std::memory_order_relaxed), t); // uncompressed bytes/s
+                ev = progress_snapshot(phase);
+            }
+        } else {
+            lastBytes = -1;
+            lastEntries = -1;
+            rate = 0.0;
+            gNdjson.rate = 0.0;
+        }
+
+        if (!ev.is_null()) {
+            if (const long long eta = gEtaMs.load(std::memory_order_relaxed); eta >= 0) ev["eta"] = eta / 1000.0;
+            ev["t"] = t;
+            std::fprintf(gNdjson.out, "%s\n", ev.dump().c_str());
+        }
+        std::fflush(gNdjson.out);
+
+        lock.lock();
+        if (stopping && gNdjson.queue.empty()) break;
+    }
+}
+
+// target: "-" (stdout), "stderr", "fd:N", or a file path.
+static bool ndjson_start(const std::string &target) {
+    FILE *out = nullptr;
+    if (target.empty() || target == "-") {
+        out = stdout;
+    } else if (target == "stderr") {
+        out = stderr;
+    } else if (target.rfind("fd:", 0) == 0) {
+#ifdef _WIN32
+        out = _fdopen(std::atoi(target.c_str() + 3), "w");
+#else
+        out = fdopen(std::atoi(target.c_str() + 3), "w");
+#endif
+    } else {
+        out = open_file(target, "w");
+    }
+    if (!out) return false;
+
+    gNdjson.out = out;
+    gNdjson.start = std::chrono::steady_clock::now();
+    gNdjson.worker = std::thread(ndjson_loop);
+    return true;
+}
+
+static void ndjson_stop() {
+    if (!gNdjson.worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(gNdjson.mu);
+        gNdjson.stop = true;
+    }
+    gNdjson.cv.notify_one();
+    gNdjson.worker.join();
+    if (gNdjson.out != stdout && gNdjson.out != stderr) std::fclose(gNdjson.out);
+    gNdjson.out = nullptr;
+}
+
+static void progress_phase(const Phase p, const std::string &detail = {}) {
+    // Close the previous phase with its final counters.
+    if (json last = progress_snapshot(static_cast<Phase>(gPhase.exchange(static_cast<int>(p)))); !last.is_null())
+        ndjson_emit(std::move(last));
+
+    json ev = {{"event", "phase"}, {"phase", phase_name(p)}};
+    if (!detail.empty()) ev["detail"] = detail;
+    ndjson_emit(std::move(ev));
+}
+
+static void progress_error(const std::string &message, const int code = 0) {
+    ndjson_emit({
+        {"event", "error"}, {"phase", phase_name(static_cast<Phase>(gPhase.load()))},
+        {"message", message}, {"code", code}
+    });
+}
+
+// ============================================================
+// ETA estimation
+// ============================================================
+
+// Remaining time of the whole job (download, count, extract) is the
+// remaining work of each phase divided by its rate. The running phase blends
+// its live EWMA throughput with the rate remembered for this asset (else the
+// machine average); phases still ahead use the remembered rates only.
+// Extraction work is uncompressed bytes plus a per-entry cost, since
+// thousands of small headers and files dominate MinGW trees.
+// All of this runs on the download worker thread; readers see gEtaMs only.
+
+constexpr auto kEtaInterval = std::chrono::milliseconds(250);
+constexpr double kEtaAlpha = 0.3; // EWMA weight of the newest sample
+constexpr double kEtaWarmup = 3.0; // s of live samples before history is ignored
+constexpr long long kEtaEntryBytes = 32 * 1024; // per-entry extraction cost, in bytes
+
+enum EtaPhase { kEtaDownload, kEtaCount, kEtaExtract, kEtaPhases };
+
+static const char *const kEtaPhaseKeys[kEtaPhases] = {"download", "count", "extract"};
+
+struct EtaJob {
+    bool active = false;
+    bool extract = false;
+    std::string asset;
+    int phase = -1; // EtaPhase, -1 before the first phase
+    double hist[kEtaPhases] = {}; // remembered rates, work units/s (0 = none)
+    long long extract_hint = 0; // remembered extraction work of this asset
+    double rate[kEtaPhases] = {}; // live EWMA
+    double live_secs[kEtaPhases] = {};
+    double phase_secs[kEtaPhases] = {};
+    long long phase_work[kEtaPhases] = {};
+    long long last_work = 0;
+    std::chrono::steady_clock::time_point start, phase_start, sampled;
+    std::vector<double> predictions; // predicted total job seconds, per sample
+};
+
+static EtaJob gEta; // download worker only
+
+static std::filesystem::path eta_history_path() {
+    return app_data_dir() / "eta_history.json";
+}
+
+static json eta_load_history() {
+    std::string data;
+    if (!read_file(eta_history_path(), data)) return json::object();
+    try {
+        json h = json::parse(data);
+        if (h.is_object()) return h;
+    } catch (...) {
+    }
+    return json::object();
+}
+
+// Work done and total of a phase; total < 0 when unknown.
+static long long eta_work(const int phase, long long &total) {
+    switch (phase) {
+        case kEtaDownload:
+            total = gXferTotal.load(std::memory_order_relaxed) > 0 ? gXferTotal.load(std::memory_order_relaxed) : -1;
+            return gXferBytes.load(std::memory_order_relaxed);
+        case kEtaCount:
+            total = gXferTotal.load(std::memory_order_relaxed) > 0 ? gXferTotal.load(std::memory_order_relaxed) : -1;
+            return gCountBytes.load(std::memory_order_relaxed);
+        default: {
+            const long long bytes = gExtractBytesTotal.load(std::memory_order_relaxed);
+            total = bytes > 0
+                        ? bytes + gExtractTotal.load(std::memory_order_relaxed) * kEtaEntryBytes
+                        : (gEta.extract_hint > 0 ? gEta.extract_hint : -1);
+            return gExtractBytes.load(std::memory_order_relaxed)
+                   + gExtractDone.load(std::memory_order_relaxed) * kEtaEntryBytes;
+        }
+    }
+}
+
+// Seconds left for the job, or < 0 when a phase has neither total nor rate.
+static double eta_remaining() {
+    double left = 0.0;
+    const int last = gEta.extract ? kEtaExtract : kEtaDownload;
+    for (int p = std::max(gEta.phase, 0); p <= last; ++p) {
+        long long total = 0;
+        long long done = eta_work(p, total);
+        if (total < 0) return -1.0;
+        if (p != gEta.phase) done = 0; // not started yet
+
+        double rate = gEta.hist[p];
+        if (p == gEta.phase && gEta.live_secs[p] > 0.0) {
+            const double w = std::min(1.0, gEta.live_secs[p] / kEtaWarmup);
+            rate = rate > 0.0 ? w * gEta.rate[p] + (1.0 - w) * rate : gEta.rate[p];
+        }
+        if (rate <= 0.0) return -1.0;
+        left += static_cast<double>(std::max(total - done, 0LL)) / rate;
+    }
+    return left;
+}
+
+// "about 1 min 20 s left"; empty when unknown.
+static std::string format_eta(const long long ms) {
+    if (ms < 0) return {};
+    const long long s = (ms + 999) / 1000;
+    char buf[64];
+    if (s >= 3600) std::snprintf(buf, sizeof(buf), "about %lld h %lld min left", s / 3600, s % 3600 / 60);
+    else if (s >= 60) std::snprintf(buf, sizeof(buf), "about %lld min %lld s left", s / 60, s % 60);
+    else std::snprintf(buf, sizeof(buf), "about %lld s left", s);
+    return buf;
+}
+
+static void awake_update_eta(void *) {
+    gStatusEta = format_eta(gEtaMs.load(std::memory_order_relaxed));
+    set_status(gStatusText);
+}
+
+// Rate-limited sample of the running phase; cheap enough for hot loops.
+static void eta_tick() {
+    if (!gEta.active || gEta.phase < 0) return;
+    const auto now = std::chrono::steady_clock::now();
+    if (now - gEta.sampled < kEtaInterval) return;
+
+    const double dt = std::chrono::duration<double>(now - gEta.sampled).count();
+    long long total = 0;
+    const long long work = eta_work(gEta.phase, total);
+    const double inst = static_cast<double>(work - gEta.last_work) / dt;
+    double &rate = gEta.rate[gEta.phase];
+    rate = gEta.live_secs[gEta.phase] > 0.0 ? (1.0 - kEtaAlpha) * rate + kEtaAlpha * inst : inst;
+    gEta.live_secs[gEta.phase] += dt;
+    gEta.last_work = work;
+    gEta.sampled = now;
+
+    const double left = eta_remaining();
+    gEtaMs.store(left < 0.0 ? -1 : std::llround(left * 1000.0), std::memory_order_relaxed);
+    if (left >= 0.0) gEta.predictions.push_back(seconds_since(gEta.start) + left);
+    ui_awake(awake_update_eta);
+}
+
+static void eta_begin(const Asset &asset, const bool extract) {
+    gEta = EtaJob{};
+    gEta.active = true;
+    gEta.extract = extract;
+    gEta.asset = asset.name;
+    gEta.start = std::chrono::steady_clock::now();
+
+    gEtaMs = -1;
+
+    try {
+        const json h = eta_load_history();
+        const json machine = h.value("machine", json::object());
+        const json mine = h.value("assets", json::object()).value(asset.name, json::object());
+        for (int p = 0; p < kEtaPhases; ++p)
+            gEta.hist[p] = mine.value(kEtaPhaseKeys[p], machine.value(kEtaPhaseKeys[p], 0.0));
+        gEta.extract_hint = mine.value("extract_work", 0LL);
+    } catch (...) {
+        // unreadable history: live rates only
+    }
+}
+
+static void eta_phase(const int phase) {
+    if (!gEta.active) return;
+    const auto now = std::chrono::steady_clock::now();
+    if (gEta.phase >= 0) {
+        long long total = 0;
+        gEta.phase_secs[gEta.phase] = std::chrono::duration<double>(now - gEta.phase_start).count();
+        gEta.phase_work[gEta.phase] = eta_work(gEta.phase, total);
+    }
+    gEta.phase = phase;
+    gEta.phase_start = gEta.sampled = now;
+    gEta.last_work = 0;
+}
+
+// Ends the job; on success stores the measured rates and scores the
+// predictions made along the way against the actual duration.
+static void eta_finish(const bool ok) {
+    if (!gEta.active) return;
+    eta_phase(-1);
+    gEta.active = false;
+    gEtaMs = -1;
+    ui_awake(awake_update_eta);
+    if (!ok || gCancel) return;
+
+    json h = eta_load_history();
+    if (!h["machine"].is_object()) h["machine"] = json::object();
+    if (!h["assets"].is_object()) h["assets"] = json::object();
+    json &machine = h["machine"];
+    json &mine = h["assets"][gEta.asset];
+    if (!mine.is_object()) mine = json::object();
+    for (int p = 0; p < kEtaPhases; ++p) {
+        // Too short to say anything (cache hit, tiny archive).
+        if (gEta.phase_secs[p] < 0.5 || gEta.phase_work[p] <= 0) continue;
+        const double rate = static_cast<double>(gEta.phase_work[p]) / gEta.phase_secs[p];
+        mine[kEtaPhaseKeys[p]] = rate;
+        const double prev = machine.value(kEtaPhaseKeys[p], 0.0);
+        machine[kEtaPhaseKeys[p]] = prev > 0.0 ? 0.5 * prev + 0.5 * rate : rate;
+    }
+    if (gEta.extract && gEta.phase_work[kEtaExtract] > 0) mine["extract_work"] = gEta.phase_work[kEtaExtract];
+
+    const double actual = seconds_since(gEta.start);
+    if (!gEta.predictions.empty() && actual > 0.0) {
+        double sum = 0.0;
+        for (const double predicted: gEta.predictions) sum += std::fabs(predicted - actual);
+        const double meanError = sum / static_cast<double>(gEta.predictions.size()) / actual;
+        const double firstError = (gEta.predictions.front() - actual) / actual;
+
+        mine["eta_error"] = meanError;
+        gMetrics.eta_error.observe(meanError);
+        LOG_EVENT(LogLevel::Info, "eta.accuracy", LogField("asset", gEta.asset),
+                  LogField("actual_ms", std::llround(actual * 1000.0)),
+                  LogField("first_predicted_ms", std::llround(gEta.predictions.front() * 1000.0)),
+                  LogField("mean_error_permille", std::llround(meanError * 1000.0)));
+        ndjson_emit({
+            {"event", "eta"}, {"actual", actual}, {"first_predicted", gEta.predictions.front()},
+            {"first_error", firstError}, {"mean_abs_error", meanError},
+            {"samples", gEta.predictions.size()}
+        });
+    }
+    write_file_atomic(eta_history_path(), h.dump(2));
+}
+
+// ============================================================
+// Download + extraction (worker threads)
+// ============================================================
+
+static void awake_download_done(void *) {
+    gInventoryDirty = true;
+    if (const int res = gLastCurlResult.load(); res == CURLE_OK) set_status("Download complete.");
+    else set_status("Download failed or cancelled.");
+    gProgress->value(0);
+    gProgress->redraw();
+}
+
+static void awake_update_progress(void *) {
+    const auto progress =
+            static_cast<float>(gProgressValue.load(std::memory_order_relaxed));
+
+    gProgress->value(progress);
+    gProgress->redraw();
+}
+
+static void awake_update_extract_progress(void *) {
+    const int total = gExtractTotal.load(std::memory_order_relaxed);
+    const int done = gExtractDone.load(std::memory_order_relaxed);
+
+    float percent = 0.0f;
+
+    if (total > 0) {
+        percent = static_cast<float>(
+            (static_cast<double>(done) / static_cast<double>(total)) * 100.0
+        );
+    }
+
+    gProgress->value(percent);
+    gProgress->redraw();
+}
+
+// One file transfer; also the curl write/progress callback context.
+struct Transfer {
+    std::string path;
+    FILE *fp = nullptr;
+    CURL *curl = nullptr;
+    curl_off_t offset = 0; // bytes already on disk when the request started
+    curl_off_t received = 0; // bytes written by this transfer
+    bool checked = false; // response status inspected on first write
+    unsigned gen = 0; // speculative transfers: warm-up generation
+    std::string *mem = nullptr; // in-memory transfer: body goes here, not to `path`
+    size_t mem_limit = 0; // beyond this (the announced size) the body moves to `path`
+    bool spilled = false; // mem_limit was exceeded
+};
+
+static int progress_callback(void *clientp,
+                             const curl_off_t total, const curl_off_t now,
+                             curl_off_t, curl_off_t) {
+    if (gCancel) return 1; // abort
+
+    const curl_off_t offset = clientp ? static_cast<const Transfer *>(clientp)->offset : 0;
+    gXferBytes.store(offset + now, std::memory_order_relaxed);
+    if (total > 0) {
+        gXferTotal.store(offset + total, std::memory_order_relaxed);
+        gProgressValue = static_cast<double>(offset + now) / static_cast<double>(offset + total) * 100.0;
+        ui_awake(awake_update_progress);
+    }
+    eta_tick();
+    return 0;
+}
+
+// An archive on disk, or already in memory (`data` non-empty; `path` is then
+// only used in messages).
+struct ArchiveSource {
+    std::string path;
+    std::string_view data;
+};
+
+// One entry of an archive's table of contents (see extract-one).
+struct TocEntry {
+    std::string path;
+    long long size = 0;
+    bool dir = false;
+    long long crc = -1; // CRC-32 of the data, -1 = unknown
+};
+
+static int archive_open_source(archive *ar, const ArchiveSource &src) {
+    if (!src.data.empty()) return archive_read_open_memory(ar, src.data.data(), src.data.size());
+    return archive_read_open_filename(ar, src.path.c_str(), 10240);
 }
 
 // Pass 1: count entries so we can show percentage during extraction.
-static int count_archive_entries(const std::string &archivePath, std::string &err) {
+// `unpacked` gets the sum of the entry sizes (for the ETA).
+static int count_archive_entries(const ArchiveSource &src, std::string &err, long long &unpacked) {
+    archive *ar = archive_read_new();
+    if (!ar) {
+        err = "libarchive init failed";
+        return -1;
+    }
+
+    archive_read_support_format_7zip(ar);
+    archive_read_support_format_zip(ar);
+    archive_read_support_format_tar(ar);
+    archive_read_support_filter_all(ar);
+
+    int r = archive_open_source(ar, src);
+    if (r != ARCHIVE_OK) {
+        err = archive_error_string(ar) ? archive_error_string(ar) : "open archive failed";
+        archive_read_free(ar);
+        return -1;
+    }
+
+    int count = 0;
+    unpacked = 0;
+    gCountBytes = 0;
+    archive_entry *entry = nullptr;
+    while ((r = archive_read_next_header(ar, &entry)) == ARCHIVE_OK) {
+        ++count;
+        if (archive_entry_size_is_set(entry)) unpacked += archive_entry_size(entry);
+        archive_read_data_skip(ar);
+        gCountBytes.store(archive_filter_bytes(ar, -1), std::memory_order_relaxed);
+        eta_tick();
+    }
+
+    if (r != ARCHIVE_EOF) {
+        err = archive_error_string(ar) ? archive_error_string(ar) : "count header failed";
+        archive_read_free(ar);
+        return -1;
+    }
+
+    archive_read_close(ar);
+    archive_read_free(ar);
+    return count;
+}
+
+// Folder picker (Windows implementation).
+// If you want cross-platform: replace this with Fl_Native_File_Chooser.
+static std::string pick_output_dir() {
+#ifdef _WIN32
+    std::string result;
+
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+    if (FAILED(hr)) return {};
+
+    IFileDialog *pfd = nullptr;
+
+    hr = CoCreateInstance(CLSID_FileOpenDialog, nullptr,
+                          CLSCTX_INPROC_SERVER,
+                          IID_PPV_ARGS(&pfd));
+    if (SUCCEEDED(hr)) {
+        DWORD options;
+        hr = pfd->GetOptions(&options);
+        if (FAILED(hr)) {
+            pfd->Release();
+            CoUninitialize();
+            return {};
+        }
+
+        hr = pfd->SetOptions(options | FOS_PICKFOLDERS | FOS_FORCEFILESYSTEM);
+        if (FAILED(hr)) {
+            pfd->Release();
+            CoUninitialize();
+            return {};
+        }
+
+        hr = pfd->Show(nullptr);
+        if (SUCCEEDED(hr)) {
+            IShellItem *psi = nullptr;
+            if (SUCCEEDED(pfd->GetResult(&psi))) {
+                PWSTR path = nullptr;
+                if (SUCCEEDED(psi->GetDisplayName(SIGDN_FILESYSPATH, &path))) {
+                    char buffer[MAX_PATH];
+                    WideCharToMultiByte(CP_UTF8, 0,
+                                        path, -1,
+                                        buffer, MAX_PATH,
+                                        nullptr, nullptr);
+                    result = buffer;
+                    CoTaskMemFree(path);
+                }
+                psi->Release();
+            }
+        }
+        pfd->Release();
+    }
+
+    CoUninitialize();
+    return result;
+#else
+    // TODO: implement non-Windows picker (Fl_Native_File_Chooser works).
+    return {};
+#endif
+}
+
+static void cb_browse_outdir(Fl_Widget *, void *) {
+    const std::string dir = pick_output_dir();
+    if (!dir.empty() && gOutDirInput) {
+        gOutDirInput->value(dir.c_str());
+        gOutDirInput->redraw();
+    }
+}
+
+// ------ Extraction ------
+
+// CRC-32 as in zip (reflected, 0xEDB88320); recorded in tables of contents.
+static std::uint32_t crc32_update(std::uint32_t crc, const void *data, const size_t n) {
+    static const auto table = [] {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    const auto *b = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) crc = table[(crc ^ b[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// SHA-256 (FIPS 180-4), for the digests providers publish with their assets.
+struct Sha256 {
+    void update(const void *data, size_t n) {
+        const auto *b = static_cast<const unsigned char *>(data);
+        bits += static_cast<std::uint64_t>(n) * 8;
+        while (n > 0) {
+            const size_t take = std::min(n, block.size() - used);
+            std::memcpy(block.data() + used, b, take);
+            used += take;
+            b += take;
+            n -= take;
+            if (used == block.size()) {
+                compress();
+                used = 0;
+            }
+        }
+    }
+
+    // Lower-case hex digest; the object is spent afterwards.
+    std::string hex() {
+        const std::uint64_t total = bits;
+        const unsigned char one = 0x80, zero = 0;
+        update(&one, 1);
+        while (used != 56) update(&zero, 1);
+        unsigned char len[8];
+        for (int i = 0; i < 8; ++i) len[i] = static_cast<unsigned char>(total >> (56 - 8 * i));
+        update(len, 8);
+        std::string out;
+        char digits[9];
+        for (const auto v: state) {
+            std::snprintf(digits, sizeof(digits), "%08x", v);
+            out += digits;
+        }
+        return out;
+    }
+
+private:
+    static std::uint32_t rotr(const std::uint32_t x, const int n) { return x >> n | x << (32 - n); }
+
+    void compress() {
+        static constexpr std::uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+        std::uint32_t w[64];
+        for (int i = 0; i < 16; ++i)
+            w[i] = static_cast<std::uint32_t>(block[4 * i]) << 24 | static_cast<std::uint32_t>(block[4 * i + 1]) << 16
+                   | static_cast<std::uint32_t>(block[4 * i + 2]) << 8 | block[4 * i + 3];
+        for (int i = 16; i < 64; ++i) {
+            const std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ w[i - 15] >> 3;
+            const std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ w[i - 2] >> 10;
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            const std::uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            const std::uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+    std::array<std::uint32_t, 8> state{
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    std::array<unsigned char, 64> block{};
+    size_t used = 0;
+    std::uint64_t bits = 0;
+};
+
+// `crc`, when given, is updated with the data written.
+static int copy_archive_data(archive *ar, archive *aw, std::uint32_t *crc = nullptr) {
+    const void *buff = nullptr;
+    size_t size = 0;
+    la_int64_t offset = 0;
+
+    for (;;) {
+        const int r = archive_read_data_block(ar, &buff, &size, &offset);
+
+        if (r == ARCHIVE_EOF)
+            return ARCHIVE_OK;
+
+        if (r != ARCHIVE_OK)
+            return r;
+
+        const la_ssize_t w =
+                archive_write_data_block(aw, buff, size, offset);
+
+        if (w < ARCHIVE_OK) // error is negative
+            return static_cast<int>(w);
+
+        if (crc) *crc = crc32_update(*crc, buff, size);
+        gExtractBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+        eta_tick();
+    }
+}
+
+static std::filesystem::path safe_join(const std::filesystem::path &base,
+                                       const std::filesystem::path &rel) {
+    auto out = (base / rel).lexically_normal();
+    const auto baseN = base.lexically_normal();
+
+    // Block traversal: ensure normalized output starts with base.
+    // NOTE: This is a simple prefix check; it assumes the archive entries are
+    // relative paths. We already skip absolute paths above.
+    const auto &baseStr = baseN.native();
+    if (const auto outStr = out.native(); outStr.size() < baseStr.size() || outStr.compare(0, baseStr.size(), baseStr)
+                                          != 0) {
+        throw std::runtime_error("Blocked path traversal in archive entry");
+    }
+    return out;
+}
+
+// ---- Extraction checkpoints ----
+// "<target>.extract-checkpoint" records how many entries (in archive order)
+// are fully on disk and a running digest of their headers. A restarted
+// extraction skips that prefix (zip/tar seek past the data; 7z still decodes
+// solid blocks) and resumes at the first entry not committed. The digest
+// catches a different archive behind the same name; the last committed entry
+// is checked on disk and extracted again if it is incomplete.
+
+constexpr long long kCheckpointEvery = 500; // entries
+
+struct ExtractCheckpoint {
+    long long entries = 0;
+    unsigned long long digest = 0;
+};
+
+static std::filesystem::path checkpoint_path(const std::filesystem::path &target) {
+    std::filesystem::path t = target.lexically_normal();
+    if (!t.has_filename()) t = t.parent_path(); // "dir/"
+    return t.string() + ".extract-checkpoint";
+}
+
+static long long archive_source_size(const ArchiveSource &src) {
+    if (!src.data.empty()) return static_cast<long long>(src.data.size());
+    std::error_code ec;
+    const auto n = std::filesystem::file_size(src.path, ec);
+    return ec ? -1 : static_cast<long long>(n);
+}
+
+static unsigned long long fnv1a(unsigned long long h, const void *data, const size_t n) {
+    const auto *b = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < n; ++i) h = (h ^ b[i]) * 1099511628211ULL;
+    return h;
+}
+
+static unsigned long long entry_digest(unsigned long long h, archive_entry *entry) {
+    const char *p = archive_entry_pathname(entry);
+    const long long size = archive_entry_size(entry);
+    const long long mtime = archive_entry_mtime(entry);
+    h = fnv1a(h, p ? p : "", p ? std::strlen(p) + 1 : 1);
+    h = fnv1a(h, &size, sizeof(size));
+    return fnv1a(h, &mtime, sizeof(mtime));
+}
+
+static ExtractCheckpoint load_checkpoint(const std::filesystem::path &target, const ArchiveSource &src) {
+    ExtractCheckpoint cp;
+    std::string data;
+    std::error_code ec;
+    if (!std::filesystem::is_directory(target, ec) || !read_file(checkpoint_path(target), data)) return cp;
+    try {
+        const json j = json::parse(data);
+        if (j.value("archive", "") != std::filesystem::path(src.path).filename().string()
+            || j.value("size", -1LL) != archive_source_size(src))
+            return cp;
+        cp.entries = j.value("entries", 0LL);
+        cp.digest = std::stoull(j.value("digest", "0"), nullptr, 16);
+    } catch (...) {
+        cp = {};
+    }
+    return cp;
+}
+
+static void save_checkpoint(const std::filesystem::path &target, const ArchiveSource &src,
+                            const ExtractCheckpoint &cp) {
+    char digest[17];
+    std::snprintf(digest, sizeof(digest), "%016llx", cp.digest);
+    const json j = {
+        {"archive", std::filesystem::path(src.path).filename().string()}, {"size", archive_source_size(src)},
+        {"entries", cp.entries}, {"digest", digest}
+    };
+    write_file_atomic(checkpoint_path(target), j.dump());
+}
+
+// The last committed entry of a checkpoint really is complete on disk.
+static bool entry_on_disk(const std::filesystem::path &base, archive_entry *entry) {
+    namespace fs = std::filesystem;
+    const char *p = archive_entry_pathname(entry);
+    if (!p || !*p || fs::path(p).is_absolute()) return true; // never written
+    std::error_code ec;
+    const fs::path full = safe_join(base, fs::path(p));
+    switch (archive_entry_filetype(entry)) {
+        case AE_IFREG:
+            return fs::file_size(full, ec) == static_cast<std::uintmax_t>(archive_entry_size(entry)) && !ec;
+        case AE_IFDIR:
+            return fs::is_directory(full, ec);
+        default:
+            return fs::exists(fs::symlink_status(full, ec));
+    }
+}
+
+// ---- Deterministic timestamps ----
+// Keep-unchanged: a file already on disk with the same bytes as its entry is
+// not rewritten, so its mtime stays and make/ninja/ccache see nothing new.
+// The entry is read into memory for the comparison (entries above
+// kKeepUnchangedMax are written as usual); existing directories are left
+// alone too. A fixed epoch replaces every entry's mtime.
+
+constexpr long long kKeepUnchangedMax = 256LL * 1024 * 1024;
+static std::atomic<bool> gKeepUnchanged{false};
+static std::atomic<long long> gFixedMtime{-1}; // seconds since 1970, -1 = archive times
+
+// Reads the current entry's data into `data` (sparse holes as zeros).
+static int read_entry_data(archive *ar, std::string &data) {
+    const void *buff = nullptr;
+    size_t size = 0;
+    la_int64_t offset = 0;
+    int r;
+    while ((r = archive_read_data_block(ar, &buff, &size, &offset)) == ARCHIVE_OK) {
+        if (data.size() < static_cast<size_t>(offset) + size) data.resize(static_cast<size_t>(offset) + size);
+        std::memcpy(&data[static_cast<size_t>(offset)], buff, size);
+    }
+    return r == ARCHIVE_EOF ? ARCHIVE_OK : r;
+}
+
+static int write_entry_data(archive *aw, const std::string &data) {
+    const la_ssize_t w = archive_write_data_block(aw, data.data(), data.size(), 0);
+    return w < ARCHIVE_OK ? static_cast<int>(w) : ARCHIVE_OK;
+}
+
+enum class DiskMatch { Unchecked, Same, Differs };
+
+// Keep-unchanged check of `entry` against `full`. Differs means the data has
+// been consumed into `data` and must be written from there.
+static DiskMatch match_on_disk(archive *ar, archive_entry *entry, const std::filesystem::path &full,
+                               std::string &data, int &r) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (archive_entry_filetype(entry) == AE_IFDIR)
+        return fs::is_directory(full, ec) ? DiskMatch::Same : DiskMatch::Unchecked;
+    if (archive_entry_filetype(entry) != AE_IFREG || !archive_entry_size_is_set(entry)
+        || archive_entry_size(entry) > kKeepUnchangedMax)
+        return DiskMatch::Unchecked;
+    if (const auto size = fs::file_size(full, ec); ec || size != static_cast<std::uintmax_t>(archive_entry_size(entry)))
+        return DiskMatch::Unchecked;
+
+    data.clear();
+    if ((r = read_entry_data(ar, data)) != ARCHIVE_OK) return DiskMatch::Differs;
+    data.resize(static_cast<size_t>(archive_entry_size(entry))); // trailing hole
+    gExtractBytes.fetch_add(static_cast<long long>(data.size()), std::memory_order_relaxed);
+    std::string current;
+    return read_file(full, current) && current == data ? DiskMatch::Same : DiskMatch::Differs;
+}
+
+// `toc`, when given, gets the table of contents, with the CRC of every entry
+// written (entries skipped on resume have none).
+static bool extract_archive_to_dir(const ArchiveSource &src,
+                                   const std::string &outDir,
+                                   std::string &err,
+                                   std::vector<TocEntry> *toc = nullptr) {
+    if (toc) toc->clear();
+    gExtractDone = 0;
+    gExtractBytes = 0;
+    ui_awake(awake_update_extract_progress);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    namespace fs = std::filesystem;
+    try {
+        int doneCount = 0;
+        int unchanged = 0; // keep-unchanged mode: files left as they were
+        int blocked = 0;   // absolute paths, not extracted
+        const fs::path base(outDir);
+        fs::create_directories(base);
+
+        archive *ar = archive_read_new();
+        archive *aw = archive_write_disk_new();
+        if (!ar || !aw) {
+            err = "libarchive init failed";
+            if (ar) archive_read_free(ar);
+            if (aw) archive_write_free(aw);
+            return false;
+        }
+
+        archive_read_support_format_7zip(ar);
+        archive_read_support_format_zip(ar);
+        archive_read_support_format_tar(ar);
+        archive_read_support_filter_all(ar);
+
+        archive_write_disk_set_options(aw,
+                                       ARCHIVE_EXTRACT_TIME |
+                                       ARCHIVE_EXTRACT_PERM |
+                                       ARCHIVE_EXTRACT_ACL |
+                                       ARCHIVE_EXTRACT_FFLAGS);
+        archive_write_disk_set_standard_lookup(aw);
+
+        int r = archive_open_source(ar, src);
+        if (r != ARCHIVE_OK) {
+            err = archive_error_string(ar) ? archive_error_string(ar) : "open archive failed";
+            LOG_EVENT(LogLevel::Error, "extract.error", LogField("archive", src.path), LogField("error", err));
+            archive_read_free(ar);
+            archive_write_free(aw);
+            return false;
+        }
+
+        const ExtractCheckpoint resume = load_checkpoint(base, src);
+        ExtractCheckpoint committed;
+        committed.digest = 14695981039346656037ULL; // FNV offset basis
+        if (resume.entries > 0)
+            LOG_EVENT(LogLevel::Info, "extract.resume", LogField("archive", src.path),
+                      LogField("entries", resume.entries));
+
+        archive_entry *entry = nullptr;
+        while ((r = archive_read_next_header(ar, &entry)) == ARCHIVE_OK) {
+            const long long index = committed.entries;
+            const unsigned long long digest = entry_digest(committed.digest, entry);
+            if (toc) {
+                const char *name = archive_entry_pathname(entry);
+                toc->push_back({name ? name : "", archive_entry_size(entry), archive_entry_filetype(entry) == AE_IFDIR});
+            }
+
+            if (index < resume.entries) {
+                const bool boundary = index + 1 == resume.entries;
+                if (boundary && digest != resume.digest) {
+                    // Not the archive the checkpoint was written for.
+                    LOG_EVENT(LogLevel::Warn, "extract.checkpoint_mismatch", LogField("archive", src.path));
+                    archive_read_free(ar);
+                    archive_write_free(aw);
+                    std::error_code ec;
+                    fs::remove(checkpoint_path(base), ec);
+                    return extract_archive_to_dir(src, outDir, err, toc);
+                }
+                if (!boundary || entry_on_disk(base, entry)) {
+                    archive_read_data_skip(ar);
+                    committed = {index + 1, digest};
+                    gExtractDone = ++doneCount;
+                    ui_awake(awake_update_extract_progress);
+                    continue;
+                }
+                // incomplete boundary entry: extract it again
+            }
+
+            const char *p = archive_entry_pathname(entry);
+            if (!p || !*p) {
+                archive_read_data_skip(ar);
+                committed = {index + 1, digest};
+                continue;
+            }
+
+            fs::path rel(p);
+
+            // block absolute paths
+            if (rel.is_absolute()) {
+                LOG_EVENT(LogLevel::Warn, "extract.blocked", LogField("path", p));
+                ++blocked;
+                archive_read_data_skip(ar);
+                committed = {index + 1, digest};
+                continue;
+            }
+
+            // build safe output path
+            fs::path full = safe_join(base, rel);
+            archive_entry_set_pathname(entry, full.string().c_str());
+            if (gFixedMtime.load() >= 0) archive_entry_set_mtime(entry, gFixedMtime.load(), 0);
+            const auto entryStart = std::chrono::steady_clock::now();
+
+            std::string held;
+            const DiskMatch match = gKeepUnchanged.load() ? match_on_disk(ar, entry, full, held, r)
+                                                          : DiskMatch::Unchecked;
+            std::uint32_t crc = 0;
+            bool crcKnown = true;
+            if (match == DiskMatch::Same) {
+                ++unchanged; // not even the header: the mtime stays
+            } else if (r != ARCHIVE_OK || (r = archive_write_header(aw, entry)) == ARCHIVE_OK) {
+                if (r == ARCHIVE_OK)
+                    r = match == DiskMatch::Differs ? write_entry_data(aw, held) : copy_archive_data(ar, aw, &crc);
+                if (r != ARCHIVE_OK) {
+                    err = archive_error_string(ar) ? archive_error_string(ar) : "extract data failed";
+                    LOG_EVENT(LogLevel::Error, "extract.error", LogField("path", rel.generic_string()),
+                              LogField("error", err));
+                    if (committed.entries > 0) save_checkpoint(base, src, committed);
+                    archive_read_free(ar);
+                    archive_write_free(aw);
+                    return false;
+                }
+            } else {
+                // header write failed; skip data to continue
+                LOG_EVENT(LogLevel::Warn, "extract.header_failed", LogField("path", rel.generic_string()),
+                          LogField("error", archive_error_string(aw) ? archive_error_string(aw) : ""));
+                archive_read_data_skip(ar);
+                crcKnown = match != DiskMatch::Unchecked; // the data was never read
+            }
+
+            if (match != DiskMatch::Same) archive_write_finish_entry(aw);
+            if (toc && archive_entry_filetype(entry) == AE_IFREG && crcKnown)
+                toc->back().crc = match == DiskMatch::Unchecked ? crc : crc32_update(0, held.data(), held.size());
+            LOG_EVENT(LogLevel::Debug, "extract.entry", LogField("path", rel.generic_string()),
+                      LogField("size", static_cast<long long>(archive_entry_size(entry))),
+                      LogField("us", static_cast<long long>(seconds_since(entryStart) * 1e6)));
+            // --- added ---
+            ++doneCount;
+            gExtractDone = doneCount;
+            gMetrics.extract_entries.add();
+            ui_awake(awake_update_extract_progress);
+
+            committed = {index + 1, digest};
+            if (committed.entries % kCheckpointEvery == 0) save_checkpoint(base, src, committed);
+            if (gCancel) break;
+        }
+
+        if (r == ARCHIVE_EOF && committed.entries < resume.entries) {
+            // Archive shorter than the checkpoint: not the same one.
+            archive_read_free(ar);
+            archive_write_free(aw);
+            std::error_code ec;
+            fs::remove(checkpoint_path(base), ec);
+            return extract_archive_to_dir(src, outDir, err, toc);
+        }
+
+        if (gCancel) {
+            err = "cancelled";
+            save_checkpoint(base, src, committed);
+            archive_read_free(ar);
+            archive_write_free(aw);
+            return false;
+        }
+
+        if (r != ARCHIVE_EOF) {
+            err = archive_error_string(ar) ? archive_error_string(ar) : "read header failed";
+            LOG_EVENT(LogLevel::Error, "extract.error", LogField("archive", src.path), LogField("error", err));
+            if (committed.entries > 0) save_checkpoint(base, src, committed);
+            archive_read_free(ar);
+            archive_write_free(aw);
+            return false;
+        }
+
+        archive_read_close(ar);
+        archive_read_free(ar);
+        archive_write_close(aw);
+        archive_write_free(aw);
+
+        std::error_code ec;
+        fs::remove(checkpoint_path(base), ec);
+
+        const double secs = seconds_since(t0);
+        gMetrics.extract_seconds.observe(secs);
+        if (secs > 0.0) gMetrics.extract_rate.set(static_cast<long long>(doneCount / secs));
+        LOG_EVENT(LogLevel::Info, "extract.done", LogField("archive", src.path), LogField("entries", doneCount),
+                  LogField("unchanged", unchanged), LogField("blocked", blocked),
+                  LogField("ms", static_cast<long long>(secs * 1000)));
+        return true;
+    } catch (const std::exception &ex) {
+        err = ex.what();
+        return false;
+    }
+}
+
+// ---- Fan-out extraction ----
+// Several installs of one archive from a single decode pass: every header and
+// data block read is written through one disk writer per target. Each target
+// gets its own files (no hard links), so one install can later be changed
+// without touching the others. A target that fails is dropped; the rest go on.
+
+struct FanoutTarget {
+    std::filesystem::path base;
+    archive *aw = nullptr;
+    long long bytes = 0;
+    double seconds = 0; // time spent writing into this target
+    std::string error;
+};
+
+static void fanout_fail(FanoutTarget &t, const char *what) {
+    t.error = what && *what ? what : "write failed";
+    LOG_EVENT(LogLevel::Error, "extract.target_failed", LogField("target", t.base.string()),
+              LogField("error", t.error));
+    archive_write_free(t.aw);
+    t.aw = nullptr;
+}
+
+// `targets` are output directories; on return they carry the per-target
+// byte counts and write times. Fails if any target (or the read) failed.
+// `toc`, if given, gets every entry (with the CRC-32 of regular files).
+static bool extract_archive_fanout(const ArchiveSource &src, std::vector<FanoutTarget> &targets,
+                                   std::string &err, std::vector<TocEntry> *toc = nullptr) {
+    if (toc) toc->clear();
+    namespace fs = std::filesystem;
+    gExtractDone = 0;
+    gExtractBytes = 0;
+    ui_awake(awake_update_extract_progress);
+    const auto t0 = std::chrono::steady_clock::now();
+
+    archive *ar = archive_read_new();
+    archive_read_support_format_7zip(ar);
+    archive_read_support_format_zip(ar);
+    archive_read_support_format_tar(ar);
+    archive_read_support_filter_all(ar);
+    if (archive_open_source(ar, src) != ARCHIVE_OK) {
+        err = archive_error_string(ar) ? archive_error_string(ar) : "open archive failed";
+        archive_read_free(ar);
+        return false;
+    }
+
+    for (auto &t: targets) {
+        std::error_code ec;
+        fs::create_directories(t.base, ec);
+        t.aw = archive_write_disk_new();
+        archive_write_disk_set_options(t.aw, ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM | ARCHIVE_EXTRACT_ACL
+                                             | ARCHIVE_EXTRACT_FFLAGS);
+        archive_write_disk_set_standard_lookup(t.aw);
+    }
+
+    int r;
+    int doneCount = 0;
+    int blocked = 0; // absolute paths, not extracted
+    archive_entry *entry = nullptr;
+    try {
+        while ((r = archive_read_next_header(ar, &entry)) == ARCHIVE_OK && !gCancel) {
+            const char *p = archive_entry_pathname(entry);
+            if (toc) toc->push_back({p ? p : "", archive_entry_size(entry), archive_entry_filetype(entry) == AE_IFDIR});
+            if (!p || !*p) {
+                archive_read_data_skip(ar);
+                continue;
+            }
+            const fs::path rel(p);
+            if (rel.is_absolute()) {
+                LOG_EVENT(LogLevel::Warn, "extract.blocked", LogField("path", p));
+                ++blocked;
+                archive_read_data_skip(ar);
+                continue;
+            }
+            if (gFixedMtime.load() >= 0) archive_entry_set_mtime(entry, gFixedMtime.load(), 0);
+            const char *hl = archive_entry_hardlink(entry);
+            const std::string link = hl ? hl : "";
+
+            // Header into every live target, each under its own base. ARCHIVE_WARN
+            // (e.g. an ACL or time that could not be set) still wrote the entry.
+            bool any = false;
+            for (auto &t: targets) {
+                if (!t.aw) continue;
+                archive_entry_set_pathname(entry, safe_join(t.base, rel).string().c_str());
+                if (!link.empty()) archive_entry_set_hardlink(entry, safe_join(t.base, link).string().c_str());
+                const auto w0 = std::chrono::steady_clock::now();
+                if (archive_write_header(t.aw, entry) < ARCHIVE_WARN) fanout_fail(t, archive_error_string(t.aw));
+                else any = true;
+                t.seconds += seconds_since(w0);
+            }
+            if (!any) break;
+
+            // Each block decoded once, written N times.
+            const void *buff = nullptr;
+            size_t size = 0;
+            la_int64_t offset = 0;
+            std::uint32_t crc = 0;
+            while ((r = archive_read_data_block(ar, &buff, &size, &offset)) == ARCHIVE_OK) {
+                if (toc) crc = crc32_update(crc, buff, size);
+                for (auto &t: targets) {
+                    if (!t.aw) continue;
+                    const auto w0 = std::chrono::steady_clock::now();
+                    if (archive_write_data_block(t.aw, buff, size, offset) < ARCHIVE_WARN)
+                        fanout_fail(t, archive_error_string(t.aw));
+                    else t.bytes += static_cast<long long>(size);
+                    t.seconds += seconds_since(w0);
+                }
+                gExtractBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+                eta_tick();
+            }
+            if (r != ARCHIVE_EOF) break;
+            r = ARCHIVE_OK;
+            if (toc && archive_entry_filetype(entry) == AE_IFREG) toc->back().crc = crc;
+
+            for (auto &t: targets)
+                if (t.aw && archive_write_finish_entry(t.aw) < ARCHIVE_WARN) fanout_fail(t, archive_error_string(t.aw));
+            gExtractDone = ++doneCount;
+            gMetrics.extract_entries.add();
+            ui_awake(awake_update_extract_progress);
+        }
+    } catch (const std::exception &ex) {
+        err = ex.what();
+        r = ARCHIVE_FATAL;
+    }
+
+    if (gCancel) err = "cancelled";
+    else if (r != ARCHIVE_EOF && err.empty())
+        err = archive_error_string(ar) ? archive_error_string(ar) : "read failed";
+    archive_read_free(ar);
+
+    const double secs = seconds_since(t0);
+    for (auto &t: targets) {
+        if (t.aw) {
+            archive_write_close(t.aw);
+            archive_write_free(t.aw);
+            t.aw = nullptr;
+        }
+        LOG_EVENT(t.error.empty() ? LogLevel::Info : LogLevel::Error, "extract.target",
+                  LogField("target", t.base.string()), LogField("bytes", t.bytes),
+                  LogField("write_ms", static_cast<long long>(t.seconds * 1000)), LogField("error", t.error));
+        if (err.empty() && !t.error.empty()) err = t.base.string() + ": " + t.error;
+    }
+    gMetrics.extract_seconds.observe(secs);
+    LOG_EVENT(err.empty() ? LogLevel::Info : LogLevel::Error, "extract.done", LogField("archive", src.path),
+              LogField("entries", doneCount), LogField("blocked", blocked), LogField("targets", targets.size()),
+              LogField("ms", static_cast<long long>(secs * 1000)));
+    return err.empty();
+}
+
+static void awake_extract_done(void *) {
+    gInventoryDirty = true;
+    if (gExtractOk.load() == 1) {
+        set_status("Extract complete.");
+    } else if (gExtractOk.load() == -1) {
+        set_status(std::string("Extract failed: " + gExtractErr));
+    }
+}
+
+// "x.7z" -> "x", "x.pkg.tar.zst" -> "x" (MSYS2 packages)
+static std::string artifact_stem(const std::string &name) {
+    for (const char *ext: {".pkg.tar.zst", ".pkg.tar.xz", ".tar.zst", ".tar.xz", ".tar.gz"}) {
+        const size_t n = std::strlen(ext);
+        if (name.size() > n && name.compare(name.size() - n, n, ext) == 0)
+            return name.substr(0, name.size() - n);
+    }
+    return std::filesystem::path(name).stem().string();
+}
+
+// ------ Download helpers ------
+static size_t file_write_cb(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    auto *const t = static_cast<Transfer *>(userdata);
+    if (!t) return 0;
+
+    // Resuming, but the server ignored the Range header: start over.
+    if (!t->checked) {
+        t->checked = true;
+        long status = 0;
+        curl_easy_getinfo(t->curl, CURLINFO_RESPONSE_CODE, &status);
+        if (t->offset > 0 && status != 206) {
+            fclose(t->fp);
+            t->fp = open_file(t->path, "wb");
+            t->offset = 0;
+            if (!t->fp) return 0;
+        }
+    }
+
+    // size*nmemb is what cURL expects caller to consume
+    const size_t n = size * nmemb;
+
+    if (t->mem) {
+        if (t->mem->size() + n <= t->mem_limit) {
+            t->mem->append(static_cast<const char *>(ptr), n);
+            t->received += static_cast<curl_off_t>(n);
+            gMetrics.download_bytes.add(n);
+            return n;
+        }
+        // Bigger than announced: carry on in the file.
+        LOG_EVENT(LogLevel::Warn, "transfer.spill", LogField("path", t->path), LogField("bytes", t->mem->size()));
+        t->fp = open_file(t->path, "wb");
+        if (!t->fp || fwrite(t->mem->data(), 1, t->mem->size(), t->fp) != t->mem->size()) return 0;
+        std::string().swap(*t->mem);
+        t->mem = nullptr;
+        t->spilled = true;
+    }
+    if (!t->fp) return 0;
+
+    const size_t written = fwrite(ptr, 1, n, t->fp);
+    t->received += static_cast<curl_off_t>(written);
+    gMetrics.download_bytes.add(written);
+    return written;
+}
+
+// Download `url` into `t.path` (or `t.mem`). With `resume`, an existing
+// partial file is continued with a Range request. Starts from the cached
+// redirect target if there is one; if that answers 403 (expired or revoked
+// signature), goes back through the original URL and caches the new target.
+static CURLcode fetch_to_file(Transfer &t, const std::string &url, const bool resume,
+                              curl_xferinfo_callback progress, const curl_off_t maxSpeed) {
+    namespace fs = std::filesystem;
+
+    CURL *curl = curl_easy_init();
+    if (!curl) return CURLE_FAILED_INIT;
+    t.curl = curl;
+
+    std::string target = resolved_url_for(url);
+    CURLcode res;
+    char errbuf[CURL_ERROR_SIZE];
+
+    for (;;) {
+        std::error_code ec;
+        t.offset = resume ? static_cast<curl_off_t>(fs::file_size(t.path, ec)) : 0;
+        if (ec) t.offset = 0;
+        t.checked = false;
+
+        if (t.mem) t.mem->clear(); // a retry starts over
+        else t.fp = open_file(t.path, t.offset > 0 ? "ab" : "wb");
+        if (!t.fp && !t.mem) {
+            LOG_EVENT(LogLevel::Error, "transfer.open_failed", LogField("path", t.path));
+            res = CURLE_WRITE_ERROR;
+            break;
+        }
+
+        errbuf[0] = '\0';
+        net_setup_easy(curl, target.c_str());
+        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
+        curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+        curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, t.offset);
+        curl_easy_setopt(curl, CURLOPT_MAX_RECV_SPEED_LARGE, maxSpeed);
+
+        // write
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, file_write_cb);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &t);
+
+        // progress + cancel
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &t);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+        res = curl_easy_perform(curl);
+        if (t.fp) fclose(t.fp);
+        t.fp = nullptr;
+
+        long status = 0;
+        curl_off_t totalUs = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &totalUs);
+        net_note_transfer(curl);
+        LOG_EVENT(res == CURLE_OK ? LogLevel::Info : LogLevel::Warn, "transfer.done",
+                  LogField("url", log_url(target)), LogField("curl", static_cast<int>(res)), LogField("http", status),
+                  LogField("offset", static_cast<long long>(t.offset)),
+                  LogField("bytes", static_cast<long long>(t.received)),
+                  LogField("us", static_cast<long long>(totalUs)));
+        if (res != CURLE_OK)
+            LOG_EVENT(LogLevel::Warn, "transfer.error", LogField("curl", static_cast<int>(res)),
+                      LogField("error", errbuf[0] ? errbuf : curl_easy_strerror(res)));
+
+        if (char *effective = nullptr; t.checked && target == url && status < 400
+                                       && curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective) == CURLE_OK
+                                       && effective) {
+            remember_resolved_url(url, effective);
+        }
+
+        if (res == CURLE_HTTP_RETURNED_ERROR && status == 403 && target != url && !gCancel) {
+            gMetrics.retries.add();
+            LOG_EVENT(LogLevel::Warn, "transfer.retry", LogField("url", log_url(url)), LogField("http", status));
+            forget_resolved_url(url);
+            target = url;
+            continue;
+        }
+        break;
+    }
+
+    curl_easy_cleanup(curl);
+    t.curl = nullptr;
+    return res;
+}
+
+// ------ Local cache ------
+
+// Archives fetched through the cache land in <app data>/cache (or
+// $MINGWDL_CACHE) under <provider>/<tag>/<name>: providers and releases
+// reuse asset names. A ".part" sibling holds an unfinished download.
+static std::filesystem::path cache_dir() {
+    namespace fs = std::filesystem;
+    const char *env = std::getenv("MINGWDL_CACHE");
+    const fs::path dir = env && *env ? fs::path(env) : app_data_dir() / "cache";
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    return dir;
+}
+
+// One path component from a provider label or a tag: no separators, not hidden.
+static std::string cache_component(const std::string &s) {
+    std::string out = s.empty() ? "_" : s;
+    for (char &c: out)
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-' && c != '_' && c != '+') c = '_';
+    if (out.front() == '.') out.front() = '_';
+    return out;
+}
+
+static std::filesystem::path cache_path_for(const Asset &a) {
+    const size_t slash = a.release.find('/');
+    const std::filesystem::path dir = cache_dir() / cache_component(a.release.substr(0, slash))
+                                      / cache_component(slash == std::string::npos ? "" : a.release.substr(slash + 1));
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    return dir / a.name;
+}
+
+// Only a file of the announced size is complete: with no size known, a
+// cached file may be a truncated one and is fetched again.
+static bool cache_has_complete(const Asset &a) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(cache_path_for(a), ec);
+    return !ec && a.size > 0 && size == static_cast<std::uintmax_t>(a.size);
+}
+
+// Put a cached archive at `outPath`: hard link when possible, else copy.
+static bool place_cached_file(const std::filesystem::path &cached, const std::filesystem::path &outPath) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+
+    if (fs::equivalent(cached, outPath, ec)) return true;
+
+    fs::remove(outPath, ec);
+    fs::create_hard_link(cached, outPath, ec);
+    if (!ec) return true;
+
+    ec.clear();
+    fs::copy_file(cached, outPath, fs::copy_options::overwrite_existing, ec);
+    return !ec;
+}
+
+// ------ Shared cache: one downloader per archive ------
+
+// Processes sharing a cache directory coordinate through "<name>.lock", an OS
+// file lock that dies with its holder. The holder downloads into the .part
+// file and renames it into place; the others follow the .part as it grows and
+// use the finished file, or take the download over if the holder goes away.
+// The lock file itself is left behind: deleting it would race new holders.
+
+struct CacheLock {
+#ifdef _WIN32
+    HANDLE h = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+
+    CacheLock() = default;
+    CacheLock(const CacheLock &) = delete;
+    CacheLock &operator=(const CacheLock &) = delete;
+    ~CacheLock() { release(); }
+
+    bool try_acquire(const std::filesystem::path &path) { return lock(path, false); }
+
+    // Waits for the holder; for short critical sections only.
+    bool acquire(const std::filesystem::path &path) { return lock(path, true); }
+
+    void release() {
+#ifdef _WIN32
+        if (h != INVALID_HANDLE_VALUE) CloseHandle(h); // drops the lock
+        h = INVALID_HANDLE_VALUE;
+#else
+        if (fd >= 0) close(fd);
+        fd = -1;
+#endif
+    }
+
+private:
+    bool lock(const std::filesystem::path &path, const bool wait) {
+#ifdef _WIN32
+        h = CreateFileW(path.wstring().c_str(), GENERIC_READ | GENERIC_WRITE,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (h == INVALID_HANDLE_VALUE) return false;
+        OVERLAPPED ov{};
+        if (LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY), 0, 1, 0, &ov))
+            return true;
+#else
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+        if (fd < 0) return false;
+        int rc;
+        while ((rc = flock(fd, LOCK_EX | (wait ? 0 : LOCK_NB))) != 0 && wait && errno == EINTR) {}
+        if (rc == 0) return true;
+#endif
+        release();
+        return false;
+    }
+};
+
+// MINGWDL_CACHE names a cache shared with other processes (build servers):
+// every download then goes through it.
+static bool shared_cache() {
+    const char *env = std::getenv("MINGWDL_CACHE");
+    return env && *env;
+}
+
+constexpr int kCacheWaitPollMs = 250;
+
+// Held by whichever transfer is writing into the cache (prefetch or download).
+static std::mutex gCacheFileMu;
+static std::atomic<bool> gPrefetchEnabled{false};
+
+// In-memory mode (download + extract without writing the archive): largest
+// asset kept in RAM, 0 = off. Bigger or unsized assets go to disk as usual.
+constexpr long long kDefaultMemoryLimit = 1024LL * 1024 * 1024;
+static std::atomic<long long> gMemoryLimit{0};
+
+static std::string gUiText;
+
+static void awake_set_status(void *) {
+    set_status(gUiText);
+}
+
+static void post_status(const char *s) {
+    if (gHeadless) {
+        std::fprintf(stderr, "%s\n", s);
+        return;
+    }
+    gUiText = s;
+    Fl::awake(awake_set_status);
+}
+
+// Completes the cached copy of `asset`: downloads it under the cache lock, or
+// waits for the process holding it. Caller holds gCacheFileMu.
+static CURLcode fill_cache(const Asset &asset, curl_xferinfo_callback progress) {
+    namespace fs = std::filesystem;
+    const fs::path cached = cache_path_for(asset);
+    const std::string part = cached.string() + ".part";
+    const auto t0 = std::chrono::steady_clock::now();
+    bool waited = false;
+
+    for (;;) {
+        if (cache_has_complete(asset)) break;
+
+        if (CacheLock lock; lock.try_acquire(cached.string() + ".lock")) {
+            if (cache_has_complete(asset)) break; // renamed just before we got the lock
+            Transfer t;
+            t.path = part;
+            const CURLcode res = fetch_to_file(t, asset.url, true, progress, 0);
+
+            std::error_code ec;
+            if (res == CURLE_OK) fs::rename(t.path, cached, ec);
+            return res != CURLE_OK ? res : ec ? CURLE_WRITE_ERROR : CURLE_OK;
+        }
+
+        if (!waited) {
+            waited = true;
+            post_status("Waiting for another process downloading this archive...");
+            LOG_EVENT(LogLevel::Info, "cache.wait", LogField("asset", asset.name));
+        }
+        if (gCancel) return CURLE_ABORTED_BY_CALLBACK;
+
+        // The holder's .part is our progress.
+        std::error_code ec;
+        const auto size = fs::file_size(part, ec);
+        progress(nullptr, asset.size > 0 ? asset.size : 0, ec ? 0 : static_cast<curl_off_t>(size), 0, 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(kCacheWaitPollMs));
+    }
+
+    if (waited)
+        LOG_EVENT(LogLevel::Info, "cache.wait_done", LogField("asset", asset.name),
+                  LogField("ms", static_cast<long long>(seconds_since(t0) * 1000)));
+    gXferBytes = gXferTotal.load();
+    return CURLE_OK;
+}
+
+// ------ Tables of contents ------
+
+static std::filesystem::path toc_path(const std::string &archiveName, const long long size) {
+    return cache_dir() / "toc" / (archiveName + "." + std::to_string(size) + ".json");
+}
+
+static std::filesystem::path toc_path_for(const ArchiveSource &src) {
+    return toc_path(std::filesystem::path(src.path).filename().string(), archive_source_size(src));
+}
+
+static void save_toc(const std::filesystem::path &path, const std::vector<TocEntry> &toc) {
+    json j = json::array();
+    for (const auto &e: toc) {
+        j.push_back({{"p", e.path}, {"s", e.size}, {"d", e.dir}});
+        if (e.crc >= 0) j.back()["c"] = e.crc;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    write_file_atomic(path, j.dump());
+}
+
+static bool read_toc_file(const std::filesystem::path &path, std::vector<TocEntry> &toc) {
+    toc.clear();
+    std::string data;
+    if (!read_file(path, data)) return false;
+    try {
+        for (const auto &e: json::parse(data))
+            toc.push_back({e.at("p").get<std::string>(), e.value("s", 0LL), e.value("d", false), e.value("c", -1LL)});
+        return true;
+    } catch (...) {
+        toc.clear();
+        return false;
+    }
+}
+
+// ------ Contents index ------
+
+// Which cached archive (and release) ships a file: <cache>/toc/index.tsv,
+// merged from each table of contents as it is saved. Archive lines
+// "#id<TAB>name<TAB>size<TAB>release<TAB>published" come first, then one
+// line per path in sorted order: "path<TAB>id:size:crc ..." (crc "-" when
+// unknown). Lookups binary-search the sorted paths, so path and prefix
+// queries take microseconds once the file is loaded.
+
+struct IndexArchive {
+    std::string name;
+    long long size = 0;
+    std::string release; // "provider/tag", empty for local archives
+    std::string published;
+};
+
+struct ContentsIndex {
+    std::vector<IndexArchive> archives;
+    std::vector<std::pair<std::string, std::string> > paths; // sorted: path -> postings
+};
+
+struct IndexHit {
+    std::string path;
+    const IndexArchive *archive = nullptr;
+    long long size = 0;
+    std::string crc;
+};
+
+static std::mutex gIndexMu; // index.tsv writers in this process; index.tsv.lock for other processes
+
+static std::filesystem::path index_path() {
+    return cache_dir() / "toc" / "index.tsv";
+}
+
+static bool load_index(ContentsIndex &ix) {
+    std::string data;
+    if (!read_file(index_path(), data)) return false;
+
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t end = data.find('\n', pos);
+        if (end == std::string::npos) end = data.size();
+        const std::string_view line(data.data() + pos, end - pos);
+        pos = end + 1;
+
+        const size_t tab = line.find('\t');
+        if (tab == std::string_view::npos) continue;
+        if (line[0] == '#') {
+            std::vector<std::string> f;
+            for (size_t b = 1, e; b <= line.size(); b = e + 1) {
+                e = std::min(line.find('\t', b), line.size());
+                f.emplace_back(line.substr(b, e - b));
+            }
+            if (f.size() < 5) return false;
+            ix.archives.push_back({f[1], std::atoll(f[2].c_str()), f[3], f[4]});
+        } else {
+            ix.paths.emplace_back(line.substr(0, tab), line.substr(tab + 1));
+        }
+    }
+    return true;
+}
+
+static void save_index(const ContentsIndex &ix) {
+    std::string out;
+    for (size_t i = 0; i < ix.archives.size(); ++i) {
+        const auto &a = ix.archives[i];
+        out += "#" + std::to_string(i) + "\t" + a.name + "\t" + std::to_string(a.size) + "\t" + a.release + "\t"
+                + a.published + "\n";
+    }
+    for (const auto &[path, postings]: ix.paths) out += path + "\t" + postings + "\n";
+    std::error_code ec;
+    std::filesystem::create_directories(index_path().parent_path(), ec);
+    write_file_atomic(index_path(), out);
+}
+
+// Adds one archive's files to `ix` (or replaces them, when the same name and
+// size is indexed already). A known release is kept if `release` is empty.
+// Returns the number of files added.
+static size_t merge_into_index(ContentsIndex &ix, const std::string &name, const long long size,
+                               const std::string &release, const std::string &published,
+                               const std::vector<TocEntry> &toc) {
+    size_t id = 0;
+    while (id < ix.archives.size() && (ix.archives[id].name != name || ix.archives[id].size != size)) ++id;
+    if (id == ix.archives.size()) {
+        ix.archives.push_back({name, size, release, published});
+    } else {
+        if (!release.empty()) ix.archives[id] = {name, size, release, published};
+        // drop the old postings of this archive
+        const std::string tag = std::to_string(id) + ":";
+        for (auto &entry: ix.paths) {
+            std::string &postings = entry.second;
+            std::string kept;
+            for (size_t b = 0, e; b < postings.size(); b = e + 1) {
+                e = std::min(postings.find(' ', b), postings.size());
+                if (postings.compare(b, tag.size(), tag) == 0) continue;
+                if (!kept.empty()) kept += ' ';
+                kept.append(postings, b, e - b);
+            }
+            postings = std::move(kept);
+        }
+        ix.paths.erase(std::remove_if(ix.paths.begin(), ix.paths.end(),
+                                      [](const auto &p) { return p.second.empty(); }), ix.paths.end());
+    }
+
+    std::vector<std::pair<std::string, std::string> > added;
+    for (const auto &e: toc) {
+        if (e.dir || e.path.empty() || e.path.find_first_of("\t\n") != std::string::npos) continue;
+        char crc[16] = "-";
+        if (e.crc >= 0) std::snprintf(crc, sizeof(crc), "%08llx", static_cast<unsigned long long>(e.crc));
+        added.emplace_back(e.path, std::to_string(id) + ":" + std::to_string(e.size) + ":" + crc);
+    }
+    std::sort(added.begin(), added.end());
+    added.erase(std::unique(added.begin(), added.end(),
+                            [](const auto &a, const auto &b) { return a.first == b.first; }), added.end());
+
+    // merge the two sorted lists
+    std::vector<std::pair<std::string, std::string> > merged;
+    merged.reserve(ix.paths.size() + added.size());
+    auto a = ix.paths.begin();
+    auto b = added.begin();
+    while (a != ix.paths.end() || b != added.end()) {
+        if (b == added.end() || (a != ix.paths.end() && a->first < b->first)) {
+            merged.push_back(std::move(*a++));
+        } else if (a == ix.paths.end() || b->first < a->first) {
+            merged.push_back(std::move(*b++));
+        } else {
+            merged.emplace_back(std::move(a->first), a->second + " " + b->second);
+            ++a;
+            ++b;
+        }
+    }
+    ix.paths = std::move(merged);
+    return added.size();
+}
+
+// A damaged index.tsv is rebuilt from the tables of contents in toc/
+// ("<archive>.<size>.json"); releases are filled in again as archives are
+// indexed from the catalog.
+static void rebuild_index(ContentsIndex &ix) {
+    namespace fs = std::filesystem;
+    ix = {};
+    std::error_code ec;
+    std::vector<TocEntry> toc;
+    for (fs::directory_iterator it(index_path().parent_path(), ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".json") continue;
+        const std::string stem = it->path().stem().string();
+        const size_t dot = stem.rfind('.');
+        if (dot == std::string::npos || dot == 0 || stem.find_first_not_of("0123456789", dot + 1) != std::string::npos
+            || !read_toc_file(it->path(), toc))
+            continue;
+        merge_into_index(ix, stem.substr(0, dot), std::atoll(stem.c_str() + dot + 1), "", "", toc);
+    }
+}
+
+static void index_archive(const std::string &name, const long long size, const std::string &release,
+                          const std::string &published, const std::vector<TocEntry> &toc) {
+    const auto t0 = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(gIndexMu);
+    // Read-modify-write: the file lock keeps another process's merge from
+    // being lost in between.
+    std::error_code ec;
+    std::filesystem::create_directories(index_path().parent_path(), ec);
+    CacheLock fileLock;
+    fileLock.acquire(index_path().string() + ".lock");
+    ContentsIndex ix;
+    if (!load_index(ix) && std::filesystem::exists(index_path(), ec)) {
+        // A partly parsed index would be saved without everything after the bad line.
+        LOG_EVENT(LogLevel::Warn, "index.rebuild", LogField("path", index_path().string()));
+        rebuild_index(ix);
+    }
+
+    const size_t added = merge_into_index(ix, name, size, release, published, toc);
+    save_index(ix);
+    LOG_EVENT(LogLevel::Info, "index.add", LogField("archive", name), LogField("files", added),
+              LogField("paths", ix.paths.size()), LogField("archives", ix.archives.size()),
+              LogField("ms", static_cast<long long>(seconds_since(t0) * 1000)));
+}
+
+static void index_hits(const ContentsIndex &ix, const std::string &path, const std::string &postings,
+                       std::vector<IndexHit> &hits) {
+    for (size_t b = 0, e; b < postings.size(); b = e + 1) {
+        e = std::min(postings.find(' ', b), postings.size());
+        const std::string p = postings.substr(b, e - b);
+        const size_t c1 = p.find(':'), c2 = p.find(':', c1 + 1);
+        const size_t id = std::strtoul(p.c_str(), nullptr, 10);
+        if (c2 == std::string::npos || id >= ix.archives.size()) continue;
+        hits.push_back({path, &ix.archives[id], std::atoll(p.c_str() + c1 + 1), p.substr(c2 + 1)});
+    }
+}
+
+// Exact path, or every path starting with `key` when `prefix` is set.
+static std::vector<IndexHit> index_lookup(const ContentsIndex &ix, const std::string &key, const bool prefix) {
+    std::vector<IndexHit> hits;
+    auto it = std::lower_bound(ix.paths.begin(), ix.paths.end(), key,
+                               [](const auto &p, const std::string &k) { return p.first < k; });
+    for (; it != ix.paths.end() && it->first.compare(0, key.size(), key) == 0; ++it) {
+        if (!prefix && it->first.size() != key.size()) break;
+        index_hits(ix, it->first, it->second, hits);
+    }
+    return hits;
+}
+
+// Every file with CRC-32 `crc` (8 hex digits): a scan, not a lookup.
+static std::vector<IndexHit> index_lookup_crc(const ContentsIndex &ix, const std::string &crc) {
+    std::vector<IndexHit> hits;
+    const std::string needle = ":" + crc;
+    for (const auto &[path, postings]: ix.paths)
+        if (postings.find(needle) != std::string::npos) {
+            index_hits(ix, path, postings, hits);
+            hits.erase(std::remove_if(hits.begin(), hits.end(), [&](const IndexHit &h) { return h.crc != crc; }),
+                       hits.end());
+        }
+    return hits;
+}
+
+// ------ Installed trees and profile links ------
+
+// Install mode keeps one tree per archive side by side (<root>/<stem>) and
+// points a profile link (<root>/<profile>, "current" by default) at one of
+// them: a symlink, or on Windows a junction (no privilege needed). A tree
+// is extracted under "<stem>.partial" and renamed when complete; the link
+// is then replaced, so a build going through the profile sees the old tree
+// or the new one, never half an install. Switching back is a link flip.
+// Installs are recorded in <app data>/installs.json.
+
+constexpr const char *kDefaultProfile = "current";
+constexpr const char *kTreeMarker = ".mingwdl.json"; // in every extracted tree
+static std::string gInstallProfile; // install mode when set
+
+// A profile is a link name next to the trees: no separators, and not hidden
+// or "."/".." (which would also collide with the .partial/.link-* names).
+static bool valid_profile_name(const std::string &name) {
+    return !name.empty() && name.find_first_of("/\\") == std::string::npos && name.front() != '.';
+}
+
+static std::mutex gInstallsMu;
+
+static std::filesystem::path installs_path() {
+    return app_data_dir() / "installs.json";
+}
+
+static json load_installs() {
+    std::string data;
+    if (read_file(installs_path(), data)) {
+        try {
+            if (json j = json::parse(data); j.is_array()) return j;
+        } catch (const std::exception &) {
+        }
+    }
+    return json::array();
+}
+
+// `tree` is listed in installs.json.
+static bool recorded_install(const std::filesystem::path &tree) {
+    const std::string path = std::filesystem::absolute(tree).lexically_normal().string();
+    std::lock_guard<std::mutex> lock(gInstallsMu);
+    const json all = load_installs();
+    return std::any_of(all.begin(), all.end(), [&](const json &r) {
+        return r.is_object() && r.value("tree", "") == path;
+    });
+}
+
+// A tree this tool extracted completely: it has the marker, or an install
+// record. Any other directory of the same name is not ours to reuse.
+static bool complete_tree(const std::filesystem::path &tree) {
+    std::error_code ec;
+    return std::filesystem::is_regular_file(tree / kTreeMarker, ec) || recorded_install(tree);
+}
+
+// Provider and archive name with the version parts ("14.2.0", "rev1",
+// "r2", MSYS2 pkgrel) blanked: gc keeps N installs of each.
+// "x86_64-14.2.0-release-posix-seh-ucrt-rt_v12-rev1.7z" -> "x86_64-#-release-posix-seh-ucrt-rt_v12-#".
+static std::string variant_key(const Asset &asset) {
+    const std::string stem = artifact_stem(asset.name);
+    std::string key = asset.release.substr(0, asset.release.find('/')) + ":";
+    for (size_t b = 0, e; b <= stem.size(); b = e + 1) {
+        e = std::min(stem.find('-', b), stem.size());
+        const std::string tok = stem.substr(b, e - b);
+        const size_t digits = tok.rfind("rev", 0) == 0 ? 3 : tok.rfind('r', 0) == 0 ? 1 : 0;
+        const bool version = !tok.empty() && (std::isdigit(static_cast<unsigned char>(tok[0]))
+                                              || (digits > 0 && tok.size() > digits
+                                                  && tok.find_first_not_of("0123456789", digits) == std::string::npos));
+        key += (b ? "-" : "") + (version ? std::string("#") : tok);
+    }
+    return key;
+}
+
+// Marks `tree` as a complete extraction of `asset` (read by the inventory).
+static void write_tree_marker(const std::filesystem::path &tree, const Asset &asset) {
+    const json j = {
+        {"asset", asset.name}, {"size", asset.size}, {"release", asset.release},
+        {"extracted", format_iso_utc(std::time(nullptr))}
+    };
+    write_file_atomic(tree / kTreeMarker, j.dump(2));
+}
+
+static void record_install(const std::filesystem::path &tree, const Asset &asset, const std::string &profile) {
+    std::lock_guard<std::mutex> lock(gInstallsMu);
+    json all = load_installs();
+    const std::string path = std::filesystem::absolute(tree).lexically_normal().string();
+    for (auto it = all.begin(); it != all.end();)
+        it = it->value("tree", "") == path ? all.erase(it) : it + 1;
+    all.push_back({
+        {"tree", path}, {"asset", asset.name}, {"release", asset.release}, {"published", asset.published_at},
+        {"profile", profile}, {"variant", variant_key(asset)}, {"installed", format_iso_utc(std::time(nullptr))}
+    });
+    write_file_atomic(installs_path(), all.dump(2));
+}
+
+#ifdef _WIN32
+// Directory junction: an empty directory with a mount-point reparse point.
+// Points the directory `link` (empty, or a junction already) at `target`.
+// FSCTL_SET_REPARSE_POINT replaces the data of an existing mount point in
+// place, so a junction is retargeted without ever being absent.
+static bool set_junction(const std::filesystem::path &link, const std::filesystem::path &target, std::string &err) {
+    // REPARSE_DATA_BUFFER (mount point variant); the struct lives in DDK headers.
+    struct MountPointBuffer {
+        DWORD tag;
+        WORD dataLength;
+        WORD reserved;
+        WORD substituteOffset;
+        WORD substituteLength;
+        WORD printOffset;
+        WORD printLength;
+        WCHAR paths[1];
+    };
+
+    std::error_code ec;
+    const std::wstring print = std::filesystem::absolute(target, ec).wstring();
+    const std::wstring substitute = L"\\??\\" + print;
+    const size_t pathBytes = (substitute.size() + 1 + print.size() + 1) * sizeof(WCHAR);
+    std::vector<char> buf(offsetof(MountPointBuffer, paths) + pathBytes, 0);
+    auto *rp = reinterpret_cast<MountPointBuffer *>(buf.data());
+    rp->tag = IO_REPARSE_TAG_MOUNT_POINT;
+    rp->dataLength = static_cast<WORD>(buf.size() - offsetof(MountPointBuffer, substituteOffset));
+    rp->substituteLength = static_cast<WORD>(substitute.size() * sizeof(WCHAR));
+    rp->printOffset = static_cast<WORD>((substitute.size() + 1) * sizeof(WCHAR));
+    rp->printLength = static_cast<WORD>(print.size() * sizeof(WCHAR));
+    std::memcpy(rp->paths, substitute.c_str(), (substitute.size() + 1) * sizeof(WCHAR));
+    std::memcpy(reinterpret_cast<char *>(rp->paths) + rp->printOffset, print.c_str(), (print.size() + 1) * sizeof(WCHAR));
+
+    const HANDLE h = CreateFileW(link.wstring().c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING,
+                                 FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT, nullptr);
+    DWORD written = 0;
+    const bool ok = h != INVALID_HANDLE_VALUE
+                    && DeviceIoControl(h, FSCTL_SET_REPARSE_POINT, buf.data(), static_cast<DWORD>(buf.size()), nullptr,
+                                       0, &written, nullptr);
+    const DWORD error = ok ? 0 : GetLastError();
+    if (h != INVALID_HANDLE_VALUE) CloseHandle(h);
+    if (!ok) err = "cannot set junction " + link.string() + " (error " + std::to_string(error) + ")";
+    return ok;
+}
+
+static bool make_junction(const std::filesystem::path &link, const std::filesystem::path &target, std::string &err) {
+    if (!CreateDirectoryW(link.wstring().c_str(), nullptr)) {
+        err = "cannot create " + link.string();
+        return false;
+    }
+    if (set_junction(link, target, err)) return true;
+    RemoveDirectoryW(link.wstring().c_str());
+    return false;
+}
+#endif
+
+// Points <root>/<profile> at `tree` (a directory in `root`).
+// True for a symlink and, on Windows, a junction (fs::is_symlink() is false
+// for those; ask for the reparse point).
+static bool is_link(const std::filesystem::path &p) {
+    std::error_code ec;
+    if (std::filesystem::is_symlink(std::filesystem::symlink_status(p, ec))) return true;
+#ifdef _WIN32
+    const DWORD attrs = GetFileAttributesW(p.wstring().c_str());
+    return attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_REPARSE_POINT);
+#else
+    return false;
+#endif
+}
+
+static bool switch_profile(const std::filesystem::path &root, const std::string &profile,
+                           const std::filesystem::path &tree, std::string &err) {
+    namespace fs = std::filesystem;
+    const fs::path link = root / profile;
+    const fs::path fresh = root / (profile + ".link-new");
+    std::error_code ec;
+
+    if (fs::exists(link, ec) && !is_link(link)) {
+        err = link.string() + " exists and is not a link";
+        return false;
+    }
+
+    fs::remove(fresh, ec);
+#ifdef _WIN32
+    // An existing junction is retargeted in place. Only a first link (or a
+    // symbolic link, whose tag cannot be rewritten) goes through renames:
+    // there is no atomic replace for directories, so swap by two renames and
+    // drop the old link (RemoveDirectory removes the link, not the tree).
+    if (fs::exists(fs::symlink_status(link, ec)) && set_junction(link, tree, err)) {
+        LOG_EVENT(LogLevel::Info, "install.switch", LogField("profile", link.string()), LogField("tree", tree.string()));
+        return true;
+    }
+    err.clear();
+    if (!make_junction(fresh, tree, err)) return false;
+    const fs::path old = root / (profile + ".link-old");
+    fs::remove(old, ec);
+    if (fs::exists(fs::symlink_status(link, ec))) fs::rename(link, old, ec);
+    if (!ec) fs::rename(fresh, link, ec);
+    if (!ec) RemoveDirectoryW(old.wstring().c_str());
+#else
+    // Relative target: the root can be moved or mounted elsewhere.
+    fs::create_directory_symlink(tree.filename(), fresh, ec);
+    if (!ec) fs::rename(fresh, link, ec); // rename(2) replaces the old link atomically
+#endif
+    if (ec) {
+        err = "cannot switch " + link.string() + ": " + ec.message();
+        fs::remove(fresh, ec);
+        return false;
+    }
+    LOG_EVENT(LogLevel::Info, "install.switch", LogField("profile", link.string()), LogField("tree", tree.string()));
+    return true;
+}
+
+static void download_file(const Asset &asset, const std::string &outPath) {
+    namespace fs = std::filesystem;
+    CURLcode res = CURLE_OK;
+
+    gXferBytes = 0;
+    gXferTotal = asset.size;
+    gExtractBytesTotal = 0;
+    eta_begin(asset, gDoExtract.load());
+    progress_phase(Phase::Download, asset.name);
+    eta_phase(kEtaDownload);
+
+    gMetrics.active_jobs.add(1);
+    const auto t0 = std::chrono::steady_clock::now();
+    LOG_EVENT(LogLevel::Info, "download.start", LogField("asset", asset.name), LogField("size", asset.size),
+              LogField("path", outPath));
+
+    std::string memArchive; // in-memory mode: the whole archive
+    const long long memLimit = gMemoryLimit.load();
+    const bool inMemory = memLimit > 0 && gDoExtract.load() && !cache_has_complete(asset)
+                          && asset.size > 0 && asset.size <= memLimit;
+    if (memLimit > 0 && gDoExtract.load() && !inMemory)
+        LOG_EVENT(LogLevel::Info, "download.in_memory_skipped", LogField("asset", asset.name),
+                  LogField("size", asset.size), LogField("limit", memLimit));
+
+    if (inMemory) {
+        memArchive.reserve(static_cast<size_t>(asset.size));
+        Transfer t;
+        t.path = outPath; // only if the body outgrows the announced size
+        t.mem = &memArchive;
+        t.mem_limit = static_cast<size_t>(asset.size); // <= memLimit; also keeps the reserve from regrowing
+        res = fetch_to_file(t, asset.url, false, progress_callback, 0);
+    } else if (gPrefetchEnabled.load() || shared_cache() || cache_has_complete(asset)) {
+        // Through the cache: a prefetched file is used as is, a partial one is
+        // taken over (the prefetch has been aborted by start_download) and
+        // finished at full speed, one being downloaded by another process is
+        // waited for.
+        std::lock_guard<std::mutex> lock(gCacheFileMu);
+        const fs::path cached = cache_path_for(asset);
+
+        if (cache_has_complete(asset)) {
+            gMetrics.cache_hits.add();
+            gXferBytes = gXferTotal.load();
+            LOG_EVENT(LogLevel::Info, "cache.hit", LogField("path", cached.string()));
+        } else {
+            gMetrics.cache_misses.add();
+            res = fill_cache(asset, progress_callback);
+        }
+
+        if (res == CURLE_OK && !place_cached_file(cached, outPath))
+            res = CURLE_WRITE_ERROR;
+    } else {
+        Transfer t;
+        t.path = outPath;
+        res = fetch_to_file(t, asset.url, false, progress_callback, 0);
+    }
+
+    gMetrics.transfer_seconds.observe(seconds_since(t0));
+    (res == CURLE_OK ? gMetrics.downloads : gMetrics.download_failures).add();
+    LOG_EVENT(res == CURLE_OK ? LogLevel::Info : LogLevel::Error, "download.done", LogField("asset", asset.name),
+              LogField("curl", static_cast<int>(res)),
+              LogField("ms", static_cast<long long>(seconds_since(t0) * 1000)));
+
+    gLastCurlResult = static_cast<int>(res);
+    ui_awake(awake_download_done);
+    if (res != CURLE_OK)
+        progress_error(curl_easy_strerror(res), static_cast<int>(res));
+
+    // Extract
+    // Optional extract: out_dir / artifact_name /
+    if (res == CURLE_OK && gDoExtract.load()) {
+        namespace fs = std::filesystem;
+
+        const fs::path ap(outPath);
+        const fs::path outDir = ap.parent_path();
+        const fs::path artifactName = artifact_stem(ap.filename().string());
+        const fs::path extractDir = outDir / artifactName;
+
+        // Install mode: extract beside the final tree and rename it in when
+        // complete; an archive installed before is only linked again.
+        const bool install = !gInstallProfile.empty();
+        const fs::path workDir = install ? fs::path(extractDir.string() + ".partial") : extractDir;
+        std::error_code ec;
+        const bool installed = install && fs::is_directory(extractDir, ec) && complete_tree(extractDir);
+
+        if (installed) {
+            gExtractOk = 1;
+            LOG_EVENT(LogLevel::Info, "install.reuse", LogField("tree", extractDir.string()));
+        } else if (install && fs::exists(fs::symlink_status(extractDir, ec))) {
+            // Not an install of ours: the rename below could not replace it.
+            gExtractOk = -1;
+            gExtractErr = extractDir.string() + " exists and is not an installed tree";
+            progress_error(gExtractErr);
+        } else {
+            // A .partial left by an interrupted run is resumed only when its
+            // checkpoint names this archive; anything else there is stale.
+            if (install && load_checkpoint(workDir, {ap.string(), memArchive}).entries == 0) {
+                fs::remove_all(workDir, ec);
+                if (ec) LOG_EVENT(LogLevel::Warn, "install.stale_partial", LogField("tree", workDir.string()),
+                                  LogField("error", ec.message()));
+            }
+
+            // ---- PASS 1: COUNT ENTRIES ----
+            post_status("Counting archive entries...");
+            progress_phase(Phase::Count, ap.filename().string());
+            eta_phase(kEtaCount);
+            gProgressValue = 0.0;
+            ui_awake(awake_update_progress);
+
+            std::string c_err;
+            long long unpacked = 0;
+
+            const ArchiveSource src{ap.string(), memArchive};
+
+            if (const int total = count_archive_entries(src, c_err, unpacked); total > 0) {
+                gExtractTotal = total;
+                gExtractBytesTotal = unpacked;
+                gExtractDone = 0;
+                ui_awake(awake_update_extract_progress);
+            } else {
+                // fallback if count fails
+                LOG_EVENT(LogLevel::Warn, "extract.count_failed", LogField("archive", ap.string()),
+                          LogField("error", c_err));
+                gExtractTotal = 0;
+            }
+
+            // ---- PASS 2: EXTRACT ----
+            post_status("Extracting...");
+            progress_phase(Phase::Extract, workDir.string());
+            eta_phase(kEtaExtract);
+
+            std::string err;
+            bool extracted;
+            if (gFanoutDirs.empty()) {
+                std::vector<TocEntry> toc;
+                extracted = extract_archive_to_dir(src, workDir.string(), err, &toc);
+                if (extracted) {
+                    save_toc(toc_path_for(src), toc);
+                    index_archive(asset.name, archive_source_size(src), asset.release, asset.published_at, toc);
+                }
+            } else {
+                std::vector<FanoutTarget> targets(1 + gFanoutDirs.size());
+                targets[0].base = workDir;
+                for (size_t i = 0; i < gFanoutDirs.size(); ++i)
+                    targets[i + 1].base = fs::path(gFanoutDirs[i]) / artifactName;
+                std::vector<TocEntry> toc;
+                extracted = extract_archive_fanout(src, targets, err, &toc);
+                if (extracted) {
+                    save_toc(toc_path_for(src), toc);
+                    index_archive(asset.name, archive_source_size(src), asset.release, asset.published_at, toc);
+                }
+
+                for (const auto &t: targets) {
+                    const double rate = t.seconds > 0 ? static_cast<double>(t.bytes) / t.seconds : 0.0;
+                    char line[512];
+                    std::snprintf(line, sizeof(line), "%s: %.1f MB, %.2f s writing (%.1f MB/s)%s%s",
+                                  t.base.string().c_str(), static_cast<double>(t.bytes) / 1e6, t.seconds, rate / 1e6,
+                                  t.error.empty() ? "" : " - ", t.error.c_str());
+                    post_status(line);
+                    ndjson_emit({
+                        {"event", "target"}, {"path", t.base.string()}, {"bytes", t.bytes}, {"seconds", t.seconds},
+                        {"rate", rate}, {"ok", t.error.empty()}
+                    });
+                }
+            }
+
+            if (extracted) {
+                gExtractOk = 1;
+                write_tree_marker(workDir, asset);
+            } else {
+                gExtractOk = -1;
+                gExtractErr = err;
+                gMetrics.extract_failures.add();
+                progress_error(err);
+            }
+        }
+
+        if (install && gExtractOk.load() == 1) {
+            std::string err;
+            if (!installed) fs::rename(workDir, extractDir, ec);
+            if (ec) err = "cannot rename " + workDir.string() + ": " + ec.message();
+            if (err.empty() && switch_profile(outDir, gInstallProfile, extractDir, err)) {
+                record_install(extractDir, asset, gInstallProfile);
+                post_status(("Installed; " + (outDir / gInstallProfile).string() + " -> "
+                             + artifactName.string()).c_str());
+            } else {
+                gExtractOk = -1;
+                gExtractErr = err;
+                progress_error(err);
+            }
+        }
+
+        ui_awake(awake_extract_done);
+    }
+
+    gMetrics.active_jobs.add(-1);
+    eta_finish(res == CURLE_OK && (!gDoExtract.load() || gExtractOk.load() == 1));
+    progress_phase(Phase::Done);
+}
+
+// ============================================================
+// Inventory (cached archives, installed trees)
+// ============================================================
+
+// A worker stats, for the assets of the shown release: the cached archive
+// and its .part, the archive in the output directory, "<out>/<stem>" with
+// its marker file and the trees in installs.json. Results go to gInventory
+// and <app data>/inventory.json (with a CRC-32 of each cached archive,
+// recomputed only when its size or mtime changes); the rows are then
+// re-labelled on the UI thread. Refreshes run when the list is rebuilt or
+// a job ends, and every kInventoryPeriod seconds.
+
+constexpr double kInventoryPoll = 0.5; // s, dirty-flag check
+constexpr double kInventoryPeriod = 30.0; // s, full refresh
+static std::atomic<bool> gInventoryBusy{false};
+static std::atomic<bool> gInventoryStop{false}; // set at exit; the worker gives up
+static std::thread gInventoryThread; // UI thread only; joined by shutdown_services()
+
+static std::filesystem::path inventory_path() {
+    return app_data_dir() / "inventory.json";
+}
+
+static long long file_mtime_key(const std::filesystem::path &p) {
+    std::error_code ec;
+    const auto t = std::filesystem::last_write_time(p, ec);
+    return ec ? 0 : static_cast<long long>(t.time_since_epoch().count());
+}
+
+static bool file_crc32(const std::filesystem::path &p, std::uint32_t &crc,
+                       const std::atomic<bool> *stop = nullptr) {
+    std::ifstream in(p, std::ios::binary);
+    if (!in) return false;
+    std::vector<char> buf(1 << 20);
+    crc = 0;
+    while (in) {
+        if (stop && stop->load()) return false;
+        in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+        crc = crc32_update(crc, buf.data(), static_cast<size_t>(in.gcount()));
+    }
+    return !in.bad();
+}
+
+static void awake_inventory_changed(void *) {
+    const int r_idx = gRelease->value();
+    if (r_idx < 0 || r_idx >= static_cast<int>(gReleases.size())) return;
+    const auto &rel = gReleases[r_idx];
+    char line[1024];
+    for (size_t row = 0; row < gAssetIndexMap.size(); ++row) {
+        format_asset_row(line, sizeof(line), rel.assets[static_cast<size_t>(gAssetIndexMap[row])]);
+        if (std::strcmp(line, gAssets->text(static_cast<int>(row) + 1)) != 0)
+            gAssets->text(static_cast<int>(row) + 1, line);
+    }
+}
+
+static void refresh_inventory(const std::vector<Asset> &assets, const std::string &outDir) {
+    namespace fs = std::filesystem;
+    const auto t0 = std::chrono::steady_clock::now();
+
+    json saved;
+    if (std::string data; read_file(inventory_path(), data)) {
+        try {
+            saved = json::parse(data);
+        } catch (const std::exception &) {
+        }
+    }
+    if (!saved.is_object()) saved = json::object();
+
+    std::unordered_map<std::string, std::vector<std::string> > installed;
+    for (const auto &rec: load_installs()) installed[rec.value("asset", "")].push_back(rec.value("tree", ""));
+
+    int hashed = 0;
+    for (const auto &a: assets) {
+        if (gInventoryStop.load()) return; // exiting: keep inventory.json as it was
+        InventoryItem item;
+        json rec = json::object();
+        std::error_code ec;
+
+        const fs::path cached = cache_path_for(a);
+        if (const auto size = fs::file_size(cached, ec); !ec && (a.size <= 0 || size == static_cast<std::uintmax_t>(a.size))) {
+            item.cached = static_cast<long long>(size);
+            const long long mtime = file_mtime_key(cached);
+            json old = saved.contains(a.name) ? saved[a.name].value("archive", json::object()) : json::object();
+            std::string crc = old.value("size", -1LL) == item.cached && old.value("mtime", 0LL) == mtime
+                                  ? old.value("crc32", "")
+                                  : "";
+            if (std::uint32_t c = 0; crc.empty() && file_crc32(cached, c, &gInventoryStop)) {
+                char hex[9];
+                std::snprintf(hex, sizeof(hex), "%08x", c);
+                crc = hex;
+                ++hashed;
+            }
+            rec["archive"] = {{"path", cached.string()}, {"size", item.cached}, {"mtime", mtime}, {"crc32", crc}};
+        }
+        if (const auto size = fs::file_size(cached.string() + ".part", ec); !ec) {
+            item.partial = static_cast<long long>(size);
+            rec["partial"] = item.partial;
+        }
+        if (!outDir.empty()) {
+            const fs::path out = fs::path(outDir) / a.name;
+            if (const auto size = fs::file_size(out, ec); !ec && (a.size <= 0 || size == static_cast<std::uintmax_t>(a.size))) {
+                item.downloaded = true;
+                rec["downloaded"] = out.string();
+            }
+            if (const fs::path tree = fs::path(outDir) / artifact_stem(a.name); fs::exists(tree / kTreeMarker, ec))
+                item.trees.push_back(tree.string());
+        }
+        for (const auto &tree: installed[a.name])
+            if (fs::is_directory(tree, ec)
+                && std::find(item.trees.begin(), item.trees.end(), tree) == item.trees.end())
+                item.trees.push_back(tree);
+        if (!item.trees.empty()) rec["trees"] = item.trees;
+
+        if (rec.empty()) saved.erase(a.name);
+        else saved[a.name] = rec;
+        std::lock_guard<std::mutex> lock(gInventoryMu);
+        gInventory[a.name] = std::move(item);
+    }
+
+    write_file_atomic(inventory_path(), saved.dump(1));
+    LOG_EVENT(LogLevel::Debug, "inventory.refresh", LogField("assets", assets.size()), LogField("hashed", hashed),
+              LogField("ms", static_cast<long long>(seconds_since(t0) * 1000)));
+}
+
+// UI thread: starts a refresh when asked for (or due) and none is running.
+static void inventory_timer_cb(void *) {
+    static auto last = std::chrono::steady_clock::now();
+    Fl::repeat_timeout(kInventoryPoll, inventory_timer_cb);
+
+    const bool due = seconds_since(last) >= kInventoryPeriod;
+    if ((!gInventoryDirty.load() && !due) || gInventoryBusy.exchange(true)) return;
+    gInventoryDirty = false;
+    last = std::chrono::steady_clock::now();
+
+    std::vector<Asset> assets;
+    if (const int r_idx = gRelease->value(); r_idx >= 0 && r_idx < static_cast<int>(gReleases.size()))
+        assets = gReleases[static_cast<size_t>(r_idx)].assets;
+    std::string outDir = gOutDirInput ? gOutDirInput->value() : "";
+
+    if (gInventoryThread.joinable()) gInventoryThread.join(); // finished: not busy
+    gInventoryThread = std::thread([assets = std::move(assets), outDir = std::move(outDir)] {
+        refresh_inventory(assets, outDir);
+        gInventoryBusy = false;
+        if (!gInventoryStop.load()) Fl::awake(awake_inventory_changed);
+    });
+}
+
+// ============================================================
+// Uninstall and garbage collection
+// ============================================================
+
+// A tree is first renamed into <root>/.mingwdl-trash (instant, same volume),
+// then deleted by a pool of threads walking it in parallel: each worker takes
+// a directory, removes its files and queues its subdirectories; directories
+// go last, deepest first. Deletion is synchronous: the command returns once
+// the trees are gone. Each trash entry has a <entry>.lock held while it is
+// deleted; an entry whose lock is free was left by an interrupted run and is
+// purged by the next uninstall or gc in that root, while one a concurrent run
+// is still deleting is left alone. Trees a profile link points at are never
+// removed.
+
+constexpr const char *kTrashDir = ".mingwdl-trash";
+
+struct DeleteStats {
+    std::atomic<long long> files{0};
+    std::atomic<long long> bytes{0};
+    std::atomic<long long> failed{0};
+};
+
+static void parallel_delete(const std::filesystem::path &root, DeleteStats &stats) {
+    namespace fs = std::filesystem;
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<fs::path> queue{root};
+    std::vector<fs::path> dirs{root};
+    int busy = 0;
+
+    const auto worker = [&] {
+        for (;;) {
+            fs::path dir;
+            {
+                std::unique_lock<std::mutex> lock(mu);
+                cv.wait(lock, [&] { return !queue.empty() || busy == 0; });
+                if (queue.empty()) return;
+                dir = std::move(queue.front());
+                queue.pop_front();
+                ++busy;
+            }
+            std::vector<fs::path> subdirs;
+            std::error_code ec;
+            for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+                std::error_code fe;
+                if (it->is_directory(fe) && !it->is_symlink(fe)) {
+                    subdirs.push_back(it->path());
+                    continue;
+                }
+                const auto size = it->is_regular_file(fe) ? it->file_size(fe) : 0;
+                if (fs::remove(it->path(), fe)) {
+                    ++stats.files;
+                    stats.bytes += static_cast<long long>(size);
+                } else {
+                    ++stats.failed;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(mu);
+                for (auto &d: subdirs) {
+                    dirs.push_back(d);
+                    queue.push_back(std::move(d));
+                }
+                --busy;
+            }
+            cv.notify_all();
+        }
+    };
+
+    const unsigned n = std::clamp(std::thread::hardware_concurrency(), 2u, 8u);
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < n; ++i) pool.emplace_back(worker);
+    for (auto &t: pool) t.join();
+
+    // Children were queued after their parents: remove in reverse.
+    for (auto it = dirs.rbegin(); it != dirs.rend(); ++it) {
+        std::error_code ec;
+        if (!fs::remove(*it, ec)) ++stats.failed;
+    }
+}
+
+// Profile links in the tree's directory that resolve to it.
+static std::vector<std::string> links_to_tree(const std::filesystem::path &tree) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> links;
+    std::error_code ec;
+    for (fs::directory_iterator it(tree.parent_path(), ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code e2;
+        if (it->path() != tree && fs::equivalent(it->path(), tree, e2)) links.push_back(it->path().filename().string());
+    }
+    return links;
+}
+
+static std::filesystem::path trash_lock_path(const std::filesystem::path &entry) {
+    return entry.parent_path() / (entry.filename().string() + ".lock");
+}
+
+// Renames `tree` into the trash of its root; `trashed` gets the new path and
+// `lock` the entry's lock, taken before the rename so no purge can race it.
+static bool move_to_trash(const std::filesystem::path &tree, std::filesystem::path &trashed, CacheLock &lock,
+                          std::string &err) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const fs::path trash = tree.parent_path() / kTrashDir;
+    const std::string stem = tree.filename().string() + "." + std::to_string(std::time(nullptr));
+    for (int i = 0;; ++i) {
+        trashed = trash / (i ? stem + "-" + std::to_string(i) : stem);
+        if (fs::exists(trashed, ec)) continue;
+        fs::create_directories(trash, ec); // another run may just have removed the empty trash
+        if (lock.try_acquire(trash_lock_path(trashed))) break;
+        if (i >= 16) {
+            err = "cannot lock " + trash_lock_path(trashed).string();
+            return false;
+        }
+    }
+    fs::rename(tree, trashed, ec);
+    if (ec) {
+        err = "cannot move " + tree.string() + " to the trash: " + ec.message();
+        fs::remove(trash_lock_path(trashed), ec);
+        lock.release();
+        return false;
+    }
+    return true;
+}
+
+// Deletes a trash entry whose lock the caller holds, then the lock file.
+static void purge_trash_entry(const std::filesystem::path &entry, CacheLock &lock, DeleteStats &stats) {
+    std::error_code ec;
+    if (std::filesystem::exists(std::filesystem::symlink_status(entry, ec))) parallel_delete(entry, stats);
+    std::filesystem::remove(trash_lock_path(entry), ec);
+    lock.release();
+}
+
+static void forget_installs(const std::vector<std::string> &trees) {
+    std::lock_guard<std::mutex> lock(gInstallsMu);
+    json all = load_installs();
+    for (auto it = all.begin(); it != all.end();)
+        it = std::find(trees.begin(), trees.end(), it->value("tree", "")) != trees.end() ? all.erase(it) : it + 1;
+    write_file_atomic(installs_path(), all.dump(2));
+}
+
+// Trees to remove so that each variant keeps its `keep` newest installs.
+// Linked trees always stay (and count towards `keep`).
+static std::vector<std::string> gc_candidates(const int keep) {
+    namespace fs = std::filesystem;
+    std::map<std::string, std::vector<json> > byVariant;
+    for (const auto &rec: load_installs()) {
+        std::error_code ec;
+        if (!fs::is_directory(rec.value("tree", ""), ec)) continue;
+        byVariant[rec.value("variant", rec.value("asset", ""))].push_back(rec);
+    }
+
+    std::vector<std::string> out;
+    for (auto &[variant, recs]: byVariant) {
+        // newest release first; install time breaks ties
+        std::sort(recs.begin(), recs.end(), [](const json &a, const json &b) {
+            const auto ka = a.value("published", "") + a.value("installed", "");
+            const auto kb = b.value("published", "") + b.value("installed", "");
+            return ka > kb;
+        });
+        for (size_t i = static_cast<size_t>(std::max(keep, 0)); i < recs.size(); ++i) {
+            const std::string tree = recs[i].value("tree", "");
+            if (links_to_tree(tree).empty()) out.push_back(tree);
+        }
+    }
+    return out;
+}
+
+// ============================================================
+// Single-entry extraction (extract-one)
+// ============================================================
+
+// One header-only pass builds a table of contents (archive order, path,
+// size), kept under <cache>/toc keyed by archive name and size. Extracting
+// an entry then walks the headers up to its index without reading data and
+// decodes that entry only: zip seeks via the central directory, tar and 7z
+// skip what they can (a 7z solid block is decoded from its start up to the
+// entry), and reading stops as soon as the entry is written.
+
+static archive *open_archive_reader(const ArchiveSource &src, std::string &err) {
     archive *ar = archive_read_new();
     if (!ar) {
         err = "libarchive init failed";
-        return -1;
+        return nullptr;
     }
-
     archive_read_support_format_7zip(ar);
     archive_read_support_format_zip(ar);
+    archive_read_support_format_tar(ar);
     archive_read_support_filter_all(ar);
 
-    int r = archive_read_open_filename(ar, archivePath.c_str(), 10240);
-    if (r != ARCHIVE_OK) {
+    if (archive_open_source(ar, src) != ARCHIVE_OK) {
         err = archive_error_string(ar) ? archive_error_string(ar) : "open archive failed";
         archive_read_free(ar);
-        return -1;
+        return nullptr;
     }
+    return ar;
+}
+
+static bool load_toc(const ArchiveSource &src, std::vector<TocEntry> &toc, std::string &err) {
+    const auto path = toc_path_for(src);
+    toc.clear();
+
+    if (read_toc_file(path, toc)) return true; // else (re)build it
+
+    archive *ar = open_archive_reader(src, err);
+    if (!ar) return false;
 
-    int count = 0;
     archive_entry *entry = nullptr;
+    int r;
     while ((r = archive_read_next_header(ar, &entry)) == ARCHIVE_OK) {
-        ++count;
-        archive_read_data_skip(ar);
+        const char *p = archive_entry_pathname(entry);
+        toc.push_back({p ? p : "", archive_entry_size(entry), archive_entry_filetype(entry) == AE_IFDIR});
     }
+    if (r != ARCHIVE_EOF) err = archive_error_string(ar) ? archive_error_string(ar) : "read header failed";
+    archive_read_free(ar);
+    if (r != ARCHIVE_EOF) return false;
 
-    if (r != ARCHIVE_EOF) {
-        err = archive_error_string(ar) ? archive_error_string(ar) : "count header failed";
+    save_toc(path, toc);
+    index_archive(std::filesystem::path(src.path).filename().string(), archive_source_size(src), "", "", toc);
+    return true;
+}
+
+// Exact path ("bin/gdb.exe", leading "./" ignored), else a unique file name.
+static int find_toc_entry(const std::vector<TocEntry> &toc, const std::string &name, std::string &err) {
+    const auto strip = [](std::string_view s) { return s.rfind("./", 0) == 0 ? s.substr(2) : s; };
+    std::vector<int> byName;
+    for (size_t i = 0; i < toc.size(); ++i) {
+        if (toc[i].dir) continue;
+        if (strip(toc[i].path) == strip(name)) return static_cast<int>(i);
+        if (std::filesystem::path(toc[i].path).filename() == name) byName.push_back(static_cast<int>(i));
+    }
+    if (byName.size() == 1) return byName[0];
+
+    if (byName.empty()) {
+        err = "no entry named " + name;
+    } else {
+        err = name + " is ambiguous:";
+        for (size_t i = 0; i < byName.size() && i < 5; ++i) err += "\n  " + toc[byName[i]].path;
+        if (byName.size() > 5) err += "\n  ...";
+    }
+    return -1;
+}
+
+// Streams entry `index` (with `expectPath` as a sanity check) to `out`.
+static bool extract_entry_to(const ArchiveSource &src, const int index, const std::string &expectPath,
+                             FILE *out, std::string &err) {
+    archive *ar = open_archive_reader(src, err);
+    if (!ar) return false;
+
+    archive_entry *entry = nullptr;
+    int r = ARCHIVE_OK;
+    for (int i = 0; r == ARCHIVE_OK && i <= index; ++i) r = archive_read_next_header(ar, &entry);
+    if (r != ARCHIVE_OK) {
+        err = archive_error_string(ar) ? archive_error_string(ar) : "entry not found";
         archive_read_free(ar);
-        return -1;
+        return false;
+    }
+    if (const char *p = archive_entry_pathname(entry); !p || expectPath != p) {
+        err = "archive changed since its table of contents was built";
+        std::error_code ec;
+        std::filesystem::remove(toc_path_for(src), ec);
+        archive_read_free(ar);
+        return false;
     }
 
-    archive_read_close(ar);
+    const void *buff = nullptr;
+    size_t size = 0;
+    la_int64_t offset = 0;
+    la_int64_t pos = 0;
+    while ((r = archive_read_data_block(ar, &buff, &size, &offset)) == ARCHIVE_OK) {
+        // sparse entries: fill holes
+        for (; pos < offset; ++pos) std::fputc(0, out);
+        if (std::fwrite(buff, 1, size, out) != size) {
+            err = "write failed";
+            r = ARCHIVE_FATAL;
+            break;
+        }
+        pos = offset + static_cast<la_int64_t>(size);
+    }
+    if (r != ARCHIVE_EOF && err.empty())
+        err = archive_error_string(ar) ? archive_error_string(ar) : "extract data failed";
     archive_read_free(ar);
-    return count;
+    return r == ARCHIVE_EOF;
 }
 
-// Folder picker (Windows implementation).
-// If you want cross-platform: replace this with Fl_Native_File_Chooser.
-static std::string pick_output_dir() {
-#ifdef _WIN32
-    std::string result;
+// ============================================================
+// Remote archive listing (HTTP Range)
+// ============================================================
 
-    HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
-    if (FAILED(hr)) return {};
+// 7z keeps its header at the end of the file, zip its central directory.
+// libarchive reads the asset through a sparse view of the remote file whose
+// 64 KiB blocks are fetched by Range request on first access; a listing
+// never touches entry data, so only the signature block and the tail move.
+
+constexpr long long kRemoteBlock = 64 * 1024;
+
+struct RemoteFile {
+    CURL *curl = nullptr;
+    std::string origin; // asset URL; requests go to its cached redirect target
+    std::string url; // target of the last request
+    long long size = -1; // from Content-Range
+    long long pos = 0;
+    long long fetched = 0; // bytes transferred
+    std::unordered_map<long long, std::string> blocks; // block number -> data
+    std::string error;
+};
 
-    IFileDialog *pfd = nullptr;
+struct RangeBody {
+    std::string *out;
+    size_t limit; // more than this: the server ignored the Range header
+};
 
-    hr = CoCreateInstance(CLSID_FileOpenDialog, nullptr,
-                          CLSCTX_INPROC_SERVER,
-                          IID_PPV_ARGS(&pfd));
-    if (SUCCEEDED(hr)) {
-        DWORD options;
-        hr = pfd->GetOptions(&options);
-        if (FAILED(hr)) {
-            pfd->Release();
-            CoUninitialize();
-            return {};
-        }
+static size_t range_write_cb(void *contents, const size_t size, const size_t nMemB, void *user_p) {
+    auto *body = static_cast<RangeBody *>(user_p);
+    const size_t n = size * nMemB;
+    if (body->out->size() + n > body->limit) return 0;
+    body->out->append(static_cast<const char *>(contents), n);
+    return n;
+}
 
-        hr = pfd->SetOptions(options | FOS_PICKFOLDERS | FOS_FORCEFILESYSTEM);
-        if (FAILED(hr)) {
-            pfd->Release();
-            CoUninitialize();
-            return {};
-        }
+// "Content-Range: bytes 0-65535/73400320" -> total size
+static size_t content_range_cb(char *buffer, const size_t size, const size_t nItems, void *user_p) {
+    const size_t n = size * nItems;
+    if (std::string v; header_value(std::string_view(buffer, n), "content-range", v)) {
+        if (const size_t slash = v.find('/'); slash != std::string::npos)
+            *static_cast<long long *>(user_p) = std::atoll(v.c_str() + slash + 1);
+    }
+    return n;
+}
 
-        hr = pfd->Show(nullptr);
-        if (SUCCEEDED(hr)) {
-            IShellItem *psi = nullptr;
-            if (SUCCEEDED(pfd->GetResult(&psi))) {
-                PWSTR path = nullptr;
-                if (SUCCEEDED(psi->GetDisplayName(SIGDN_FILESYSPATH, &path))) {
-                    char buffer[MAX_PATH];
-                    WideCharToMultiByte(CP_UTF8, 0,
-                                        path, -1,
-                                        buffer, MAX_PATH,
-                                        nullptr, nullptr);
-                    result = buffer;
-                    CoTaskMemFree(path);
-                }
-                psi->Release();
-            }
+// Bytes [first, last]; a negative `first` asks for the last -first bytes.
+// Goes to the cached redirect target of rf.origin; a 403 from it (expired
+// signature) is retried once through rf.origin, which re-resolves it.
+static bool remote_fetch(RemoteFile &rf, const long long first, const long long last, std::string &out) {
+    char range[64];
+    if (first < 0) std::snprintf(range, sizeof(range), "%lld", first);
+    else std::snprintf(range, sizeof(range), "%lld-%lld", first, last);
+    long long total = -1;
+    CURLcode res;
+    long status = 0;
+
+    for (rf.url = resolved_url_for(rf.origin);;) {
+        out.clear();
+        RangeBody body{&out, static_cast<size_t>(first < 0 ? -first : last - first + 1)};
+        curl_easy_reset(rf.curl);
+        net_setup_easy(rf.curl, rf.url.c_str());
+        curl_easy_setopt(rf.curl, CURLOPT_FAILONERROR, 1L);
+        curl_easy_setopt(rf.curl, CURLOPT_RANGE, range);
+        curl_easy_setopt(rf.curl, CURLOPT_WRITEFUNCTION, range_write_cb);
+        curl_easy_setopt(rf.curl, CURLOPT_WRITEDATA, &body);
+        curl_easy_setopt(rf.curl, CURLOPT_HEADERFUNCTION, content_range_cb);
+        curl_easy_setopt(rf.curl, CURLOPT_HEADERDATA, &total);
+
+        res = curl_easy_perform(rf.curl);
+        curl_easy_getinfo(rf.curl, CURLINFO_RESPONSE_CODE, &status);
+        rf.fetched += static_cast<long long>(out.size());
+        net_note_transfer(rf.curl);
+        LOG_EVENT(LogLevel::Debug, "remote.range", LogField("range", range), LogField("curl", static_cast<int>(res)),
+                  LogField("http", status));
+
+        if (status == 403 && rf.url != rf.origin) {
+            forget_resolved_url(rf.origin);
+            rf.url = rf.origin;
+            continue;
         }
-        pfd->Release();
+        if (char *effective = nullptr; res == CURLE_OK && rf.url == rf.origin
+                                       && curl_easy_getinfo(rf.curl, CURLINFO_EFFECTIVE_URL, &effective) == CURLE_OK
+                                       && effective)
+            remember_resolved_url(rf.origin, effective);
+        break;
     }
 
-    CoUninitialize();
-    return result;
-#else
-    // TODO: implement non-Windows picker (Fl_Native_File_Chooser works).
-    return {};
-#endif
+    if (res != CURLE_OK || status != 206 || total <= 0) {
+        rf.error = status == 200 || res == CURLE_WRITE_ERROR
+                       ? "server does not support range requests"
+                       : (res != CURLE_OK ? curl_easy_strerror(res) : "unexpected HTTP status");
+        return false;
+    }
+    rf.size = total;
+    return true;
+}
+
+static const std::string *remote_block(RemoteFile &rf, const long long n) {
+    if (const auto it = rf.blocks.find(n); it != rf.blocks.end()) return &it->second;
+
+    const long long first = n * kRemoteBlock;
+    const long long last = (rf.size > 0 ? std::min(first + kRemoteBlock, rf.size) : first + kRemoteBlock) - 1;
+    std::string data;
+    if (!remote_fetch(rf, first, last, data)) return nullptr;
+    if (static_cast<long long>(data.size()) != std::min(last, rf.size - 1) - first + 1) {
+        rf.error = "short range response";
+        return nullptr;
+    }
+    return &(rf.blocks[n] = std::move(data));
 }
 
-static void cb_browse_outdir(Fl_Widget *, void *) {
-    const std::string dir = pick_output_dir();
-    if (!dir.empty() && gOutDirInput) {
-        gOutDirInput->value(dir.c_str());
-        gOutDirInput->redraw();
-    }
+static la_ssize_t remote_read(archive *, void *client, const void **buf) {
+    auto &rf = *static_cast<RemoteFile *>(client);
+    if (rf.pos >= rf.size) return 0;
+    const std::string *block = remote_block(rf, rf.pos / kRemoteBlock);
+    if (!block) return ARCHIVE_FATAL;
+
+    const size_t off = static_cast<size_t>(rf.pos % kRemoteBlock);
+    *buf = block->data() + off;
+    const auto n = static_cast<la_ssize_t>(block->size() - off);
+    rf.pos += n;
+    return n;
 }
 
-// ------ Extraction ------
+static la_int64_t remote_seek(archive *, void *client, const la_int64_t offset, const int whence) {
+    auto &rf = *static_cast<RemoteFile *>(client);
+    const long long base = whence == SEEK_CUR ? rf.pos : whence == SEEK_END ? rf.size : 0;
+    rf.pos = std::clamp<long long>(base + offset, 0, rf.size);
+    return rf.pos;
+}
 
-static int copy_archive_data(archive *ar, archive *aw) {
-    const void *buff = nullptr;
-    size_t size = 0;
-    la_int64_t offset = 0;
+static la_int64_t remote_skip(archive *, void *client, const la_int64_t request) {
+    auto &rf = *static_cast<RemoteFile *>(client);
+    const long long n = std::min<long long>(request, rf.size - rf.pos);
+    rf.pos += n;
+    return n;
+}
 
-    for (;;) {
-        const int r = archive_read_data_block(ar, &buff, &size, &offset);
+// ---- Zip central directory ----
+// Parsed directly: libarchive's seekable zip reader visits every local
+// header, which remotely would mean fetching the whole file.
 
-        if (r == ARCHIVE_EOF)
-            return ARCHIVE_OK;
+struct ZipEntry {
+    std::string name;
+    unsigned long long csize = 0; // compressed
+    unsigned long long usize = 0;
+    unsigned long long offset = 0; // local header
+    unsigned method = 0; // 0 stored, 8 deflate
+    unsigned flags = 0;
+    unsigned long crc = 0;
+};
 
-        if (r != ARCHIVE_OK)
-            return r;
+static unsigned long long le(const std::string_view b, const size_t at, const int n) {
+    unsigned long long v = 0;
+    for (int i = n - 1; i >= 0; --i) v = v << 8 | static_cast<unsigned char>(b[at + i]);
+    return v;
+}
 
-        const la_ssize_t w =
-                archive_write_data_block(aw, buff, size, offset);
+// Finds the central directory from the tail of the file (`tailStart` is its
+// offset). Returns false if there is no end record in the tail.
+static bool zip_find_directory(const std::string_view tail, const long long tailStart,
+                               unsigned long long &cdOffset, unsigned long long &cdSize) {
+    if (tail.size() < 22) return false;
+    for (size_t i = tail.size() - 22 + 1; i-- > 0;) {
+        if (le(tail, i, 4) != 0x06054b50) continue;
+        cdSize = le(tail, i + 12, 4);
+        cdOffset = le(tail, i + 16, 4);
+
+        // Zip64: locator right before the end record, pointing at the zip64 record.
+        if (i >= 20 && le(tail, i - 20, 4) == 0x07064b50) {
+            const long long rec = static_cast<long long>(le(tail, i - 20 + 8, 8)) - tailStart;
+            if (rec < 0 || static_cast<size_t>(rec) + 56 > tail.size() || le(tail, rec, 4) != 0x06064b50)
+                return false;
+            cdSize = le(tail, rec + 40, 8);
+            cdOffset = le(tail, rec + 48, 8);
+        }
+        return true;
+    }
+    return false;
+}
 
-        if (w < ARCHIVE_OK) // error is negative
-            return static_cast<int>(w);
+static bool zip_parse_directory(const std::string_view cd, std::vector<ZipEntry> &out) {
+    size_t at = 0;
+    while (at + 46 <= cd.size() && le(cd, at, 4) == 0x02014b50) {
+        ZipEntry e;
+        e.flags = static_cast<unsigned>(le(cd, at + 8, 2));
+        e.method = static_cast<unsigned>(le(cd, at + 10, 2));
+        e.crc = static_cast<unsigned long>(le(cd, at + 16, 4));
+        e.csize = le(cd, at + 20, 4);
+        e.usize = le(cd, at + 24, 4);
+        const size_t nameLen = le(cd, at + 28, 2), extraLen = le(cd, at + 30, 2), commentLen = le(cd, at + 32, 2);
+        e.offset = le(cd, at + 42, 4);
+        if (at + 46 + nameLen + extraLen + commentLen > cd.size()) return false;
+        e.name.assign(cd.substr(at + 46, nameLen));
+
+        // Zip64 extra field: only the fields saturated in the fixed header, in this order.
+        for (size_t x = at + 46 + nameLen, end = x + extraLen; x + 4 <= end;) {
+            const auto id = le(cd, x, 2), len = le(cd, x + 2, 2);
+            if (id == 0x0001) {
+                size_t f = x + 4;
+                if (e.usize == 0xFFFFFFFF && f + 8 <= x + 4 + len) e.usize = le(cd, f, 8), f += 8;
+                if (e.csize == 0xFFFFFFFF && f + 8 <= x + 4 + len) e.csize = le(cd, f, 8), f += 8;
+                if (e.offset == 0xFFFFFFFF && f + 8 <= x + 4 + len) e.offset = le(cd, f, 8);
+            }
+            x += 4 + len;
+        }
+
+        out.push_back(std::move(e));
+        at += 46 + nameLen + extraLen + commentLen;
     }
+    return at == cd.size();
 }
 
-static std::filesystem::path safe_join(const std::filesystem::path &base,
-                                       const std::filesystem::path &rel) {
-    auto out = (base / rel).lexically_normal();
-    const auto baseN = base.lexically_normal();
+// Central directory of a remote zip: the tail, plus one more request if the
+// directory starts before it. `cdStart` gets the directory offset.
+static bool remote_zip_directory(RemoteFile &rf, std::vector<ZipEntry> &entries, long long *cdStart = nullptr) {
+    constexpr long long kTail = 64 * 1024 + 22; // largest end record with comment
+    std::string tail;
+    if (!remote_fetch(rf, -kTail, 0, tail)) return false;
+    const long long tailStart = rf.size - static_cast<long long>(tail.size());
+
+    unsigned long long cdOffset = 0, cdSize = 0;
+    if (!zip_find_directory(tail, tailStart, cdOffset, cdSize)
+        || cdOffset + cdSize > static_cast<unsigned long long>(rf.size)) {
+        rf.error = "zip end of central directory not found";
+        return false;
+    }
 
-    // Block traversal: ensure normalized output starts with base.
-    // NOTE: This is a simple prefix check; it assumes the archive entries are
-    // relative paths. We already skip absolute paths above.
-    const auto &baseStr = baseN.native();
-    if (const auto outStr = out.native(); outStr.size() < baseStr.size() || outStr.compare(0, baseStr.size(), baseStr)
-                                          != 0) {
-        throw std::runtime_error("Blocked path traversal in archive entry");
+    std::string cd;
+    if (static_cast<long long>(cdOffset) >= tailStart) {
+        cd = tail.substr(cdOffset - tailStart, cdSize);
+    } else if (cdSize > 0 && !remote_fetch(rf, static_cast<long long>(cdOffset),
+                                           static_cast<long long>(cdOffset + cdSize) - 1, cd)) {
+        return false;
     }
-    return out;
+    if (!zip_parse_directory(cd, entries)) {
+        rf.error = "corrupt zip central directory";
+        return false;
+    }
+    if (cdStart) *cdStart = static_cast<long long>(cdOffset);
+    return true;
 }
 
-static bool extract_archive_to_dir(const std::string &archivePath,
-                                   const std::string &outDir,
-                                   std::string &err) {
-    gExtractDone = 0;
-    Fl::awake(awake_update_extract_progress);
+static bool remote_listable(const std::string &name) {
+    const auto ext = std::filesystem::path(name).extension().string();
+    return ext == ".7z" || ext == ".zip";
+}
 
-    namespace fs = std::filesystem;
-    try {
-        int doneCount = 0;
-        const fs::path base(outDir);
-        fs::create_directories(base);
+// Contents of an asset: from the cache when complete, else remotely for
+// .7z/.zip. `fetched` gets the bytes transferred. The result is stored as
+// the archive's table of contents (see extract-one).
+static bool list_asset_contents(const Asset &asset, std::vector<TocEntry> &toc, long long &fetched,
+                                std::string &err) {
+    fetched = 0;
+    if (cache_has_complete(asset)) return load_toc({cache_path_for(asset).string(), {}}, toc, err);
+    if (!remote_listable(asset.name)) {
+        err = "listing this archive type needs the whole file; download it first";
+        return false;
+    }
 
-        archive *ar = archive_read_new();
-        archive *aw = archive_write_disk_new();
-        if (!ar || !aw) {
-            err = "libarchive init failed";
-            if (ar) archive_read_free(ar);
-            if (aw) archive_write_free(aw);
-            return false;
-        }
+    RemoteFile rf;
+    rf.origin = asset.url;
+    rf.curl = curl_easy_init();
+    if (!rf.curl) {
+        err = "curl init failed";
+        return false;
+    }
 
+    toc.clear();
+    bool ok;
+    if (std::vector<ZipEntry> entries; std::filesystem::path(asset.name).extension() == ".zip") {
+        ok = remote_zip_directory(rf, entries);
+        // archive order as libarchive sees it (by local header offset)
+        std::sort(entries.begin(), entries.end(),
+                  [](const ZipEntry &a, const ZipEntry &b) { return a.offset < b.offset; });
+        for (const auto &e: entries) {
+            const bool dir = !e.name.empty() && e.name.back() == '/';
+            toc.push_back({e.name, static_cast<long long>(e.usize), dir, static_cast<long long>(e.crc)});
+        }
+        if (!ok) err = rf.error;
+    } else if ((ok = remote_block(rf, 0) != nullptr)) { // also learns the size
+        archive *ar = archive_read_new();
         archive_read_support_format_7zip(ar);
-        archive_read_support_format_zip(ar);
-        archive_read_support_filter_all(ar);
+        archive_read_support_format_zip_seekable(ar);
+        archive_read_set_read_callback(ar, remote_read);
+        archive_read_set_seek_callback(ar, remote_seek);
+        archive_read_set_skip_callback(ar, remote_skip);
+        archive_read_set_callback_data(ar, &rf);
 
-        archive_write_disk_set_options(aw,
-                                       ARCHIVE_EXTRACT_TIME |
-                                       ARCHIVE_EXTRACT_PERM |
-                                       ARCHIVE_EXTRACT_ACL |
-                                       ARCHIVE_EXTRACT_FFLAGS);
-        archive_write_disk_set_standard_lookup(aw);
+        int r = archive_read_open1(ar);
+        archive_entry *entry = nullptr;
+        while (r == ARCHIVE_OK && (r = archive_read_next_header(ar, &entry)) == ARCHIVE_OK) {
+            const char *p = archive_entry_pathname(entry);
+            toc.push_back({p ? p : "", archive_entry_size(entry), archive_entry_filetype(entry) == AE_IFDIR});
+        }
+        ok = r == ARCHIVE_EOF;
+        if (!ok) err = !rf.error.empty() ? rf.error : archive_error_string(ar) ? archive_error_string(ar) : "read failed";
+        archive_read_free(ar);
+    } else {
+        err = rf.error;
+    }
+    curl_easy_cleanup(rf.curl);
+    fetched = rf.fetched;
+
+    LOG_EVENT(ok ? LogLevel::Info : LogLevel::Warn, "remote.list", LogField("asset", asset.name),
+              LogField("size", rf.size), LogField("entries", toc.size()), LogField("fetched", fetched));
+    if (ok) {
+        save_toc(toc_path(asset.name, rf.size), toc);
+        index_archive(asset.name, rf.size, asset.release, asset.published_at, toc);
+    }
+    return ok;
+}
 
-        int r = archive_read_open_filename(ar, archivePath.c_str(), 10240);
-        if (r != ARCHIVE_OK) {
-            err = archive_error_string(ar) ? archive_error_string(ar) : "open archive failed";
-            archive_read_free(ar);
-            archive_write_free(aw);
+// ============================================================
+// Selective install from remote zip assets
+// ============================================================
+
+// Only the entries matching the include patterns are fetched: their spans
+// (local header to the next entry) come from the central directory, nearby
+// spans are merged into one Range request, and each fetched span is read by
+// libarchive's streaming zip reader from memory, inflated and written below
+// the target through safe_join().
+
+constexpr long long kCoalesceGap = 256 * 1024; // fetch gaps smaller than this
+constexpr long long kMaxSpanGroup = 64LL * 1024 * 1024; // bytes per request
+
+// '*' matches any run of characters (including '/'), '?' one character.
+static bool glob_match(const std::string_view pat, const std::string_view s) {
+    size_t p = 0, i = 0, star = std::string_view::npos, mark = 0;
+    while (i < s.size()) {
+        if (p < pat.size() && (pat[p] == '?' || pat[p] == s[i])) {
+            ++p;
+            ++i;
+        } else if (p < pat.size() && pat[p] == '*') {
+            star = p++;
+            mark = i;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            i = ++mark;
+        } else {
             return false;
         }
+    }
+    while (p < pat.size() && pat[p] == '*') ++p;
+    return p == pat.size();
+}
 
-        archive_entry *entry = nullptr;
-        while ((r = archive_read_next_header(ar, &entry)) == ARCHIVE_OK) {
+// Full path, or the file name for patterns without '/'.
+static bool matches_include(const std::vector<std::string> &patterns, const std::string &path) {
+    const std::string_view base = std::string_view(path).substr(path.find_last_of('/') + 1);
+    for (const auto &pat: patterns) {
+        if (glob_match(pat, path)) return true;
+        if (pat.find('/') == std::string::npos && glob_match(pat, base)) return true;
+    }
+    return false;
+}
+
+// Entries fetched and extracted by --include: matching files (directories
+// are created along the way). Used by the span planner and the span reader.
+static bool wanted_zip_entry(const std::string_view name, const std::vector<std::string> &patterns) {
+    return !name.empty() && name.back() != '/' && matches_include(patterns, std::string(name));
+}
+
+struct ZipSpan {
+    long long first = 0;
+    long long last = 0; // inclusive
+    int wanted = 0; // selected entries inside
+};
+
+// Reads the local entries of one fetched span; extracts the wanted ones.
+static bool extract_zip_span(const std::string &data, const int wanted, const std::vector<std::string> &patterns,
+                             const std::filesystem::path &base, int &extracted, std::string &err) {
+    namespace fs = std::filesystem;
+    archive *ar = archive_read_new();
+    archive *aw = archive_write_disk_new();
+    archive_read_support_format_zip_streamable(ar);
+    archive_write_disk_set_options(aw, ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM);
+    archive_write_disk_set_standard_lookup(aw);
+
+    int r = archive_read_open_memory(ar, data.data(), data.size());
+    int done = 0;
+    archive_entry *entry = nullptr;
+    try {
+        // Stop after the last wanted entry: the span ends at an entry boundary.
+        while (r == ARCHIVE_OK && done < wanted && (r = archive_read_next_header(ar, &entry)) == ARCHIVE_OK) {
             const char *p = archive_entry_pathname(entry);
-            if (!p || !*p) {
+            if (!p || archive_entry_filetype(entry) == AE_IFDIR || !wanted_zip_entry(p, patterns)) {
                 archive_read_data_skip(ar);
                 continue;
             }
-
-            fs::path rel(p);
-
-            // block absolute paths
-            if (rel.is_absolute()) {
+            ++done;
+
+            // Absolute or "../" paths: skipped, the rest of the span goes on.
+            const fs::path rel(p);
+            fs::path full;
+            try {
+                if (!rel.is_absolute()) full = safe_join(base, rel);
+            } catch (const std::runtime_error &) {
+            }
+            if (full.empty()) {
+                LOG_EVENT(LogLevel::Warn, "extract.blocked", LogField("path", p));
                 archive_read_data_skip(ar);
                 continue;
             }
-
-            // build safe output path
-            fs::path full = safe_join(base, rel);
             archive_entry_set_pathname(entry, full.string().c_str());
+            if ((r = archive_write_header(aw, entry)) == ARCHIVE_OK) r = copy_archive_data(ar, aw);
+            if (r != ARCHIVE_OK) break;
+            archive_write_finish_entry(aw);
+            gExtractDone = ++extracted;
+            ui_awake(awake_update_extract_progress);
+        }
+    } catch (const std::exception &ex) {
+        err = ex.what();
+        r = ARCHIVE_FATAL;
+    }
 
-            r = archive_write_header(aw, entry);
-            if (r == ARCHIVE_OK) {
-                r = copy_archive_data(ar, aw);
-                if (r != ARCHIVE_OK) {
-                    err = archive_error_string(ar) ? archive_error_string(ar) : "extract data failed";
-                    archive_read_free(ar);
-                    archive_write_free(aw);
-                    return false;
-                }
-            } else {
-                // header write failed; skip data to continue
-                archive_read_data_skip(ar);
-            }
+    const bool ok = done == wanted && r == ARCHIVE_OK;
+    if (!ok && err.empty()) {
+        const char *e = archive_error_string(ar) ? archive_error_string(ar) : archive_error_string(aw);
+        err = e ? e : "zip entry not found in fetched range";
+    }
+    archive_read_free(ar);
+    archive_write_free(aw);
+    return ok;
+}
 
-            archive_write_finish_entry(aw);
-            // --- added ---
-            ++doneCount;
-            gExtractDone = doneCount;
-            Fl::awake(awake_update_extract_progress);
+// Fetches and extracts the entries of a remote zip asset that match
+// `patterns` into `outDir`. Returns the number of entries written, or -1.
+static int fetch_zip_entries(const Asset &asset, const std::vector<std::string> &patterns,
+                             const std::filesystem::path &outDir, std::string &err) {
+    RemoteFile rf;
+    rf.origin = asset.url;
+    rf.curl = curl_easy_init();
+    if (!rf.curl) {
+        err = "curl init failed";
+        return -1;
+    }
+
+    std::vector<ZipEntry> entries;
+    long long cdStart = 0; // end of the last entry's span
+    if (!remote_zip_directory(rf, entries, &cdStart)) {
+        err = rf.error;
+        curl_easy_cleanup(rf.curl);
+        return -1;
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const ZipEntry &a, const ZipEntry &b) { return a.offset < b.offset; });
+
+    // Spans of the wanted entries, merged when close together.
+    std::vector<ZipSpan> spans;
+    int wantedTotal = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const ZipEntry &e = entries[i];
+        if (!wanted_zip_entry(e.name, patterns)) continue;
+
+        const long long first = static_cast<long long>(e.offset);
+        const long long last = (i + 1 < entries.size() ? static_cast<long long>(entries[i + 1].offset) : cdStart) - 1;
+        if (!spans.empty() && first - spans.back().last <= kCoalesceGap
+            && last - spans.back().first < kMaxSpanGroup) {
+            spans.back().last = last;
+        } else {
+            spans.push_back({first, last, 0});
         }
+        ++spans.back().wanted;
+        ++wantedTotal;
+    }
+    if (wantedTotal == 0) {
+        err = "no entry matches the include patterns";
+        curl_easy_cleanup(rf.curl);
+        return -1;
+    }
 
-        if (r != ARCHIVE_EOF) {
-            err = archive_error_string(ar) ? archive_error_string(ar) : "read header failed";
-            archive_read_free(ar);
-            archive_write_free(aw);
-            return false;
+    long long spanBytes = 0;
+    for (const auto &s: spans) spanBytes += s.last - s.first + 1;
+    gXferBytes = 0;
+    gXferTotal = spanBytes;
+    gExtractDone = 0;
+    gExtractTotal = wantedTotal;
+    LOG_EVENT(LogLevel::Info, "remote_zip.plan", LogField("asset", asset.name), LogField("entries", wantedTotal),
+              LogField("requests", spans.size()), LogField("bytes", spanBytes), LogField("size", rf.size));
+
+    const std::filesystem::path base = outDir / artifact_stem(asset.name);
+    int extracted = 0;
+    for (const auto &s: spans) {
+        if (gCancel) {
+            err = "cancelled";
+            break;
+        }
+        std::string data;
+        if (!remote_fetch(rf, s.first, s.last, data)) {
+            err = rf.error;
+            break;
         }
+        gXferBytes += static_cast<long long>(data.size());
+        gMetrics.download_bytes.add(data.size());
+        if (!extract_zip_span(data, s.wanted, patterns, base, extracted, err)) break;
+    }
+    curl_easy_cleanup(rf.curl);
+    LOG_EVENT(err.empty() ? LogLevel::Info : LogLevel::Error, "remote_zip.done", LogField("asset", asset.name),
+              LogField("entries", extracted), LogField("fetched", rf.fetched), LogField("error", err));
+    return err.empty() ? extracted : -1;
+}
 
-        archive_read_close(ar);
-        archive_read_free(ar);
-        archive_write_close(aw);
-        archive_write_free(aw);
+// ============================================================
+// Archive diff
+// ============================================================
+
+// Two archives compared by their tables of contents, without extracting:
+// both sorted by path, then merge-joined. A file changed if its size
+// differs, or both CRCs are known and differ. Without a CRC on either side
+// an equal size proves nothing: the pair is listed as unverified ('?').
+
+struct DiffLine {
+    char kind; // '+' added, '-' removed, 'M' changed, '?' same size, no CRC to compare
+    std::string path;
+    long long oldSize = 0;
+    long long newSize = 0;
+};
+
+// Local zip archives: CRCs from the central directory.
+static void fill_zip_crcs(const std::string &path, std::vector<TocEntry> &toc) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return;
+    in.seekg(0, std::ios::end);
+    const long long size = in.tellg();
+    const long long tailStart = std::max<long long>(0, size - (64 * 1024 + 22));
+    std::string tail(static_cast<size_t>(size - tailStart), '\0');
+    in.seekg(tailStart);
+    in.read(tail.data(), static_cast<std::streamsize>(tail.size()));
+
+    unsigned long long cdOffset = 0, cdSize = 0;
+    if (!in || !zip_find_directory(tail, tailStart, cdOffset, cdSize)
+        || cdOffset + cdSize > static_cast<unsigned long long>(size))
+        return;
+    std::string cd(static_cast<size_t>(cdSize), '\0');
+    in.seekg(static_cast<std::streamoff>(cdOffset));
+    in.read(cd.data(), static_cast<std::streamsize>(cd.size()));
+
+    std::vector<ZipEntry> entries;
+    if (!in || !zip_parse_directory(cd, entries)) return;
+    std::unordered_map<std::string, unsigned long> crcs;
+    for (const auto &e: entries) crcs[e.name] = e.crc;
+    for (auto &e: toc)
+        if (const auto it = crcs.find(e.path); it != crcs.end() && !e.dir) e.crc = static_cast<long long>(it->second);
+}
+
+// ARCHIVE (local file) or ASSET (remote listing, or the cached archive).
+static bool diff_side_toc(const std::string &arg, std::vector<TocEntry> &toc, std::string &err) {
+    std::error_code ec;
+    if (std::filesystem::is_regular_file(arg, ec)) {
+        if (!load_toc({arg, {}}, toc, err)) return false;
+        if (std::filesystem::path(arg).extension() == ".zip"
+            && std::any_of(toc.begin(), toc.end(), [](const TocEntry &e) { return !e.dir && e.crc < 0; }))
+            fill_zip_crcs(arg, toc);
         return true;
-    } catch (const std::exception &ex) {
-        err = ex.what();
+    }
+    const auto it = gCatalogIndex.asset_by_name.find(arg);
+    if (it == gCatalogIndex.asset_by_name.end()) {
+        err = "no such archive or asset: " + arg;
         return false;
     }
+    long long fetched = 0;
+    return list_asset_contents(gReleases[it->second.first].assets[it->second.second], toc, fetched, err);
 }
 
-static void awake_extract_done(void *) {
-    if (gExtractOk.load() == 1) {
-        set_status("Extract complete.");
-    } else if (gExtractOk.load() == -1) {
-        set_status(std::string("Extract failed: " + gExtractErr));
+// Files only, "./" stripped, sorted by path; the last of duplicate paths wins.
+static void sort_toc_for_diff(std::vector<TocEntry> &toc) {
+    toc.erase(std::remove_if(toc.begin(), toc.end(), [](const TocEntry &e) { return e.dir || e.path.empty(); }),
+              toc.end());
+    for (auto &e: toc)
+        if (e.path.rfind("./", 0) == 0) e.path.erase(0, 2);
+    std::stable_sort(toc.begin(), toc.end(), [](const TocEntry &a, const TocEntry &b) { return a.path < b.path; });
+    std::vector<TocEntry> unique;
+    unique.reserve(toc.size());
+    for (auto &e: toc) {
+        if (!unique.empty() && unique.back().path == e.path) unique.back() = std::move(e);
+        else unique.push_back(std::move(e));
     }
+    toc = std::move(unique);
 }
 
-// ------ Download helpers ------
-static size_t file_write_cb(void *ptr, size_t size, size_t nmemb, void *userdata) {
-    FILE *const fp = static_cast<FILE *>(userdata);
-    if (!fp) return 0;
-
-    // size*nmemb is what cURL expects caller to consume
-    const size_t n = size * nmemb;
-    const size_t written = fwrite(ptr, 1, n, fp);
-    return written;
+// Both tables sorted by sort_toc_for_diff.
+static std::vector<DiffLine> diff_tocs(const std::vector<TocEntry> &a, const std::vector<TocEntry> &b) {
+    std::vector<DiffLine> out;
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        if (j == b.size() || (i < a.size() && a[i].path < b[j].path)) {
+            out.push_back({'-', a[i].path, a[i].size, 0});
+            ++i;
+        } else if (i == a.size() || b[j].path < a[i].path) {
+            out.push_back({'+', b[j].path, 0, b[j].size});
+            ++j;
+        } else {
+            const bool crcs = a[i].crc >= 0 && b[j].crc >= 0;
+            if (a[i].size != b[j].size || (crcs && a[i].crc != b[j].crc))
+                out.push_back({'M', a[i].path, a[i].size, b[j].size});
+            else if (!crcs)
+                out.push_back({'?', a[i].path, a[i].size, b[j].size});
+            ++i;
+            ++j;
+        }
+    }
+    return out;
 }
 
-static std::string gUiText;
+// ============================================================
+// Offline bundles (export / import)
+// ============================================================
 
-static void awake_set_status(void *) {
-    set_status(gUiText);
+// One file carrying cached archives and the catalog to a machine without
+// network access: a header block, each archive at a 4 KiB-aligned offset
+// (so copy-on-write filesystems can share its blocks on import), a JSON index
+// {created, catalog, archives: [{name, size, offset, crc32, sha256}]} and a
+// trailer line with the index offset. Import checks every archive in
+// parallel against its SHA-256 (from the index, else the bundle's catalog;
+// CRC-32 only for assets that have no digest) and renames the good ones into
+// the cache. Ranges that run into the index are rejected before copying.
+
+constexpr const char *kBundleMagic = "MINGWDL-BUNDLE 1\n";
+constexpr const char *kBundleTrailerTag = "MINGWDL-INDEX ";
+constexpr long long kBundleAlign = 4096;
+constexpr size_t kBundleTrailer = 31; // tag, 16 hex digits, '\n'
+
+struct BundleItem {
+    std::string name;
+    long long size = 0;
+    long long offset = 0;
+    std::string crc; // 8 hex digits
+    std::string sha256; // hex digest, empty if neither index nor catalog has one
+    bool verified = false; // copied into the cache, checksum matched (else already cached)
+    bool cloned = false; // copied by the kernel (reflink where supported)
+    std::string error;
+};
+
+static std::string crc_hex(const std::uint32_t crc) {
+    char hex[9];
+    std::snprintf(hex, sizeof(hex), "%08x", crc);
+    return hex;
 }
 
-static void post_status(const char *s) {
-    gUiText = s;
-    Fl::awake(awake_set_status);
+// Published digests come in either case; ours are lower-case.
+static std::string lower_hex(std::string hex) {
+    std::transform(hex.begin(), hex.end(), hex.begin(), [](unsigned char c) { return std::tolower(c); });
+    return hex;
 }
 
-static void download_file(const std::string &url, const std::string &outPath) {
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        gLastCurlResult = static_cast<int>(CURLE_FAILED_INIT);
-        Fl::awake(awake_download_done);
-        return;
+static bool write_bundle(const std::filesystem::path &path, const std::vector<Asset> &assets, std::string &err) {
+    namespace fs = std::filesystem;
+    const std::string part = path.string() + ".part";
+    std::ofstream out(part, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        err = "cannot create " + part;
+        return false;
     }
 
-    FILE *fp = nullptr;
-#ifdef _MSC_VER
-    if (fopen_s(&fp, outPath.c_str(), "wb") != 0 || !fp) {
-#else
-        fp = fopen(outPath.c_str(), "wb");
-        if (!fp) {
+    const auto pad = [&out] {
+        const long long at = static_cast<long long>(out.tellp());
+        const std::string zeros(static_cast<size_t>((kBundleAlign - at % kBundleAlign) % kBundleAlign), '\0');
+        out.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
+    };
+    out << kBundleMagic;
+
+    json items = json::array();
+    std::vector<char> buf(1 << 20);
+    for (const auto &a: assets) {
+        pad();
+        const long long offset = static_cast<long long>(out.tellp());
+        std::ifstream in(cache_path_for(a), std::ios::binary);
+        std::uint32_t crc = 0;
+        Sha256 sha;
+        long long size = 0;
+        while (in) {
+            in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+            const auto got = in.gcount();
+            crc = crc32_update(crc, buf.data(), static_cast<size_t>(got));
+            sha.update(buf.data(), static_cast<size_t>(got));
+            out.write(buf.data(), got);
+            size += got;
+        }
+        if (in.bad() || !out || (a.size > 0 && size != a.size)) {
+            err = "cannot copy " + a.name + " from the cache";
+            return false;
+        }
+        const std::string digest = sha.hex();
+        if (!a.sha256.empty() && lower_hex(a.sha256) != digest) {
+            err = a.name + " in the cache does not match the published SHA-256";
+            return false;
+        }
+        items.push_back({
+            {"name", a.name}, {"size", size}, {"offset", offset}, {"crc32", crc_hex(crc)}, {"sha256", digest},
+            {"release", a.release}
+        });
+        std::fprintf(stderr, "added %s (%.1f MB, crc %s)\n", a.name.c_str(), static_cast<double>(size) / 1e6,
+                     crc_hex(crc).c_str());
+    }
+
+    const long long indexAt = static_cast<long long>(out.tellp());
+    const json index = {
+        {"created", format_iso_utc(std::time(nullptr))}, {"catalog", catalog_to_json(gReleases)},
+        {"archives", std::move(items)}
+    };
+    out << index.dump();
+    char trailer[kBundleTrailer + 1];
+    std::snprintf(trailer, sizeof(trailer), "%s%016llx\n", kBundleTrailerTag, static_cast<unsigned long long>(indexAt));
+    out << trailer;
+    out.close();
+
+    std::error_code ec;
+    if (!out || (fs::rename(part, path, ec), ec)) {
+        err = "cannot write " + path.string();
+        return false;
+    }
+    return true;
+}
+
+// `indexAt` gets the index offset: the end of the archive data.
+static bool read_bundle_index(const std::filesystem::path &path, json &index, long long &indexAt, std::string &err) {
+    std::ifstream in(path, std::ios::binary);
+    std::string head(std::strlen(kBundleMagic), '\0');
+    if (!in || !in.read(head.data(), static_cast<std::streamsize>(head.size())) || head != kBundleMagic) {
+        err = path.string() + " is not a bundle";
+        return false;
+    }
+    in.seekg(0, std::ios::end);
+    const long long size = static_cast<long long>(in.tellg());
+    std::string trailer(kBundleTrailer, '\0');
+    in.seekg(size - static_cast<long long>(kBundleTrailer));
+    if (!in.read(trailer.data(), static_cast<std::streamsize>(trailer.size()))
+        || trailer.compare(0, std::strlen(kBundleTrailerTag), kBundleTrailerTag) != 0) {
+        err = path.string() + ": truncated bundle (no index)";
+        return false;
+    }
+    indexAt = std::strtoll(trailer.c_str() + std::strlen(kBundleTrailerTag), nullptr, 16);
+    if (indexAt <= 0 || indexAt >= size - static_cast<long long>(kBundleTrailer)) {
+        err = path.string() + ": bad index offset";
+        return false;
+    }
+
+    std::string data(static_cast<size_t>(size - static_cast<long long>(kBundleTrailer) - indexAt), '\0');
+    in.seekg(indexAt);
+    if (!in.read(data.data(), static_cast<std::streamsize>(data.size()))) {
+        err = path.string() + ": cannot read index";
+        return false;
+    }
+    try {
+        index = json::parse(data);
+    } catch (const std::exception &e) {
+        err = path.string() + ": " + e.what();
+        return false;
+    }
+    return true;
+}
+
+// Copies item's byte range of `bundle` into `to` and returns the CRC-32 of
+// what landed there, and its SHA-256 into `sha` when given. On Linux the
+// kernel copies (copy_file_range: a reflink on Btrfs/XFS, no user-space copy
+// elsewhere) and the result is read back once; otherwise one read pass both
+// copies and checksums.
+static bool copy_bundle_range(const std::filesystem::path &bundle, BundleItem &item,
+                              const std::filesystem::path &to, std::uint32_t &crc, Sha256 *sha) {
+#ifdef __linux__
+    if (const int in = open(bundle.c_str(), O_RDONLY | O_CLOEXEC); in >= 0) {
+        const int out = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        loff_t off = item.offset;
+        long long left = item.size;
+        while (out >= 0 && left > 0) {
+            const ssize_t n = copy_file_range(in, &off, out, nullptr, static_cast<size_t>(left), 0);
+            if (n <= 0) break;
+            left -= n;
+        }
+        close(in);
+        if (out >= 0) close(out);
+        if (out >= 0 && left == 0) {
+            item.cloned = true;
+            std::ifstream back(to, std::ios::binary);
+            std::vector<char> buf(1 << 20);
+            crc = 0;
+            while (back) {
+                back.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+                crc = crc32_update(crc, buf.data(), static_cast<size_t>(back.gcount()));
+                if (sha) sha->update(buf.data(), static_cast<size_t>(back.gcount()));
+            }
+            return static_cast<bool>(back.is_open()) && !back.bad();
+        }
+    }
 #endif
-        curl_easy_cleanup(curl);
-        gLastCurlResult = static_cast<int>(CURLE_WRITE_ERROR);
-        Fl::awake(awake_download_done);
-        return;
+    std::ifstream in(bundle, std::ios::binary);
+    std::ofstream out(to, std::ios::binary | std::ios::trunc);
+    if (!in || !out || !in.seekg(item.offset)) return false;
+    std::vector<char> buf(1 << 20);
+    crc = 0;
+    for (long long left = item.size; left > 0;) {
+        const auto want = static_cast<std::streamsize>(std::min<long long>(left, static_cast<long long>(buf.size())));
+        if (!in.read(buf.data(), want)) return false;
+        crc = crc32_update(crc, buf.data(), static_cast<size_t>(want));
+        if (sha) sha->update(buf.data(), static_cast<size_t>(want));
+        out.write(buf.data(), want);
+        left -= want;
     }
+    return static_cast<bool>(out.flush());
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "mingw-downloader-fltk");
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+// Moves the archives of `bundle` into the cache (skipping those already
+// there), several at a time. Items that fail keep their `error`.
+static void import_bundle_archives(const std::filesystem::path &bundle, std::vector<BundleItem> &items) {
+    namespace fs = std::filesystem;
+    std::atomic<size_t> next{0};
+
+    const auto worker = [&] {
+        for (size_t i; (i = next++) < items.size();) {
+            BundleItem &item = items[i];
+            if (!item.error.empty()) continue; // rejected while reading the index
+            Asset a;
+            a.name = item.name;
+            a.size = item.size;
+            if (cache_has_complete(a)) continue;
+
+            const fs::path cached = cache_path_for(a);
+            CacheLock lock;
+            if (!lock.try_acquire(cached.string() + ".lock")) {
+                item.error = "being downloaded by another process";
+                continue;
+            }
+            const fs::path part = cached.string() + ".part";
+            std::uint32_t crc = 0;
+            Sha256 sha;
+            const bool bySha = !item.sha256.empty(); // CRC-32 only for assets without a digest
+            const std::string &want = bySha ? item.sha256 : item.crc;
+            std::error_code ec;
+            if (!copy_bundle_range(bundle, item, part, crc, bySha ? &sha : nullptr))
+                item.error = "cannot copy into the cache";
+            else if (const std::string got = bySha ? sha.hex() : crc_hex(crc); got != want)
+                item.error = std::string(bySha ? "SHA-256" : "CRC") + " mismatch (" + got + ", expected " + want + ")";
+            else fs::rename(part, cached, ec);
+            if (ec) item.error = "cannot rename into the cache: " + ec.message();
+            item.verified = item.error.empty();
+            if (!item.error.empty()) fs::remove(part, ec);
+            LOG_EVENT(item.error.empty() ? LogLevel::Info : LogLevel::Error, "bundle.import",
+                      LogField("asset", item.name), LogField("bytes", item.size), LogField("cloned", item.cloned),
+                      LogField("error", item.error));
+        }
+    };
 
-    // write
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, file_write_cb);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
+    const size_t n = std::min<size_t>(std::clamp(std::thread::hardware_concurrency(), 2u, 8u), items.size());
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < n; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto &t: pool) t.join();
+}
 
-    // progress + cancel
-    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_callback);
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+// Adds the bundle's releases to the catalog snapshot (same provider/tag: replaced).
+static bool merge_catalog_snapshot(const json &catalog) {
+    std::vector<Release> incoming;
+    if (!catalog_from_json(catalog, incoming)) return false;
+    std::vector<Release> releases;
+    load_catalog_snapshot(releases);
+
+    for (auto &rel: incoming) {
+        const auto same = std::find_if(releases.begin(), releases.end(), [&](const Release &r) {
+            return r.provider == rel.provider && r.tag == rel.tag;
+        });
+        if (same != releases.end()) *same = std::move(rel);
+        else releases.push_back(std::move(rel));
+    }
+    std::stable_sort(releases.begin(), releases.end(), [](const Release &a, const Release &b) {
+        return a.published_at > b.published_at;
+    });
+    return write_file_atomic(catalog_snapshot_path(), catalog_to_json(releases).dump());
+}
 
-    const CURLcode res = curl_easy_perform(curl);
+// ============================================================
+// Speculative prefetch (asset selection)
+// ============================================================
 
-    fclose(fp);
-    curl_easy_cleanup(curl);
+// Opt-in: the selected asset is downloaded into the cache at a capped rate.
+// Download takes the partial file over at full speed; moving to another asset
+// aborts the prefetch but keeps the .part for a later resume.
 
-    gLastCurlResult = static_cast<int>(res);
-    Fl::awake(awake_download_done);
+constexpr curl_off_t kPrefetchMaxSpeed = 2 * 1024 * 1024; // bytes/s
+constexpr long long kPrefetchBudget = 1024LL * 1024 * 1024; // bytes per session
 
-    // Extract
-    // Optional extract: out_dir / artifact_name /
-    if (res == CURLE_OK && gDoExtract.load()) {
-        namespace fs = std::filesystem;
+static std::atomic<long long> gPrefetchBytes{0};
 
-        const fs::path ap(outPath);
-        const fs::path outDir = ap.parent_path();
-        const fs::path artifactName = ap.stem();
-        const fs::path extractDir = outDir / artifactName;
+static int prefetch_progress_callback(void *clientp, curl_off_t, curl_off_t,
+                                      curl_off_t, curl_off_t) {
+    const auto *t = static_cast<const Transfer *>(clientp);
+    if (t->gen != gWarmGen.load(std::memory_order_relaxed)) return 1; // selection moved or promoted
+    if (gPrefetchBytes.load(std::memory_order_relaxed) + t->received > kPrefetchBudget) return 1;
+    return 0;
+}
+
+static void prefetch_asset(const Asset &asset, const unsigned gen) {
+    namespace fs = std::filesystem;
 
-        // ---- PASS 1: COUNT ENTRIES ----
-        post_status("Counting archive entries...");
-        gProgress->value(0);
-        gProgress->redraw();
+    // A download (or another prefetch) owns the cache right now.
+    std::unique_lock<std::mutex> lock(gCacheFileMu, std::try_to_lock);
+    if (!lock.owns_lock() || cache_has_complete(asset)) return;
+    if (gPrefetchBytes.load() >= kPrefetchBudget) return;
+
+    const fs::path cached = cache_path_for(asset);
+    CacheLock fileLock; // another process may be downloading it
+    if (!fileLock.try_acquire(cached.string() + ".lock")) return;
+    Transfer t;
+    t.path = cached.string() + ".part";
+    t.gen = gen;
+
+    const CURLcode res = fetch_to_file(t, asset.url, true, prefetch_progress_callback, kPrefetchMaxSpeed);
+    gPrefetchBytes += t.received;
+    LOG_EVENT(LogLevel::Info, "prefetch.done", LogField("asset", asset.name), LogField("curl", static_cast<int>(res)),
+              LogField("bytes", static_cast<long long>(t.received)));
+
+    std::error_code ec;
+    if (res == CURLE_OK) fs::rename(t.path, cached, ec);
+}
 
-        std::string c_err;
+static Asset gWarmPendingAsset; // UI thread only
 
-        if (const int total = count_archive_entries(ap.string(), c_err); total > 0) {
-            gExtractTotal = total;
-            gExtractDone = 0;
-            Fl::awake(awake_update_extract_progress);
-        } else {
-            // fallback if count fails
-            gExtractTotal = 0;
-        }
+static void warm_timer_cb(void *) {
+    const unsigned gen = gWarmGen.load();
+    std::thread([asset = gWarmPendingAsset, gen] {
+        if (gPrefetchEnabled.load()) prefetch_asset(asset, gen);
+        else warm_up_url(asset.url, gen);
+    }).detach();
+}
 
-        // ---- PASS 2: EXTRACT ----
-        post_status("Extracting...");
+// Cancels any warm-up / prefetch in flight.
+static void cancel_speculative() {
+    ++gWarmGen;
+    Fl::remove_timeout(warm_timer_cb);
+}
 
-        if (std::string err; extract_archive_to_dir(ap.string(), extractDir.string(), err)) {
-            gExtractOk = 1;
-        } else {
-            gExtractOk = -1;
-            gExtractErr = err;
-        }
+// Debounced: scrolling through the list only warms the row it settles on.
+static void schedule_warm_up(const Asset *asset) {
+    cancel_speculative();
+    if (!asset) return;
+    if (!gPrefetchEnabled.load() && resolved_url_for(asset->url) != asset->url) return;
 
-        Fl::awake(awake_extract_done);
-    }
+    gWarmPendingAsset = *asset;
+    Fl::add_timeout(kWarmDelay, warm_timer_cb);
 }
 
 // ============================================================
 // Button Callbacks
 // ============================================================
+static CatalogResult gPendingCatalog; // handed from refresh worker to UI thread
+
 static void awake_refresh_done(void *) {
     const int st = gRefreshStage.load();
+    gRefreshBusy = false;
 
     if (st == 1) {
         set_status("Network error.");
@@ -780,25 +5742,32 @@ static void awake_refresh_done(void *) {
         return;
     }
     if (st == 3) {
+        gReleases = std::move(gPendingCatalog.releases);
+        build_catalog_index();
         populate_release_choice();
-        set_status("Releases loaded.");
+
+        std::string msg = gPendingCatalog.offline ? "Offline: releases from the imported catalog." : "Releases loaded.";
+        if (!gPendingCatalog.failed.empty() && !gPendingCatalog.offline) {
+            msg += " Failed:";
+            for (const auto &f: gPendingCatalog.failed) msg += " " + f;
+        }
+        gPendingCatalog = CatalogResult{};
+        set_status(msg);
     }
 }
 
 static void on_refresh(Fl_Widget *, void *) {
+    if (gRefreshBusy.exchange(true)) return;
+
     set_status("Fetching releases...");
     gProgress->value(0);
+    progress_phase(Phase::Fetch);
 
     std::thread([] {
-        const std::string data = fetch_releases_json();
-        if (data.empty()) {
-            gRefreshStage = 1;
-            Fl::awake(awake_refresh_done);
-            return;
-        }
+        gPendingCatalog = fetch_catalog();
 
-        if (const bool ok = parse_releases(data); !ok) {
-            gRefreshStage = 2;
+        if (gPendingCatalog.releases.empty()) {
+            gRefreshStage = gPendingCatalog.parse_error ? 2 : 1;
             Fl::awake(awake_refresh_done);
             return;
         }
@@ -808,26 +5777,103 @@ static void on_refresh(Fl_Widget *, void *) {
     }).detach();
 }
 
-static void start_download(const bool extract_after) {
+// List row -> asset of the current release (nullptr if nothing selected).
+static const Asset *selected_asset() {
     const int r_idx = gRelease->value();
     const int a_row = gAssets->value();
 
-    if (r_idx < 0 || a_row <= 0) {
+    if (r_idx < 0 || r_idx >= static_cast<int>(gReleases.size()) || a_row <= 0)
+        return nullptr;
+    if (static_cast<size_t>(a_row - 1) >= gAssetIndexMap.size())
+        return nullptr;
+
+    return &gReleases[r_idx].assets[static_cast<size_t>(gAssetIndexMap[static_cast<size_t>(a_row - 1)])];
+}
+
+static void on_asset_selected(Fl_Widget *, void *) {
+    schedule_warm_up(selected_asset());
+}
+
+static void on_prefetch_toggled(Fl_Widget *w, void *) {
+    gPrefetchEnabled = static_cast<Fl_Check_Button *>(w)->value() != 0;
+    schedule_warm_up(gPrefetchEnabled.load() ? selected_asset() : nullptr);
+}
+
+// ---- Contents window ----
+
+struct ContentsResult {
+    std::string asset;
+    std::vector<TocEntry> toc;
+    long long fetched = 0;
+    std::string err;
+};
+
+static Fl_Window *gContentsWin = nullptr;
+static Fl_Hold_Browser *gContentsList = nullptr;
+
+static void awake_contents_done(void *data) {
+    const std::unique_ptr<ContentsResult> r(static_cast<ContentsResult *>(data));
+    if (!r->err.empty()) {
+        set_status("Contents: " + r->err);
+        return;
+    }
+
+    if (!gContentsWin) {
+        gContentsWin = new Fl_Window(700, 480);
+        gContentsList = new Fl_Hold_Browser(0, 0, 700, 480);
+        gContentsList->textfont(FL_COURIER);
+        static const int widths[] = {130, 0};
+        gContentsList->column_widths(widths);
+        gContentsWin->end();
+        gContentsWin->resizable(gContentsList);
+    }
+
+    long long unpacked = 0;
+    gContentsList->clear();
+    for (const auto &e: r->toc) {
+        unpacked += e.size;
+        gContentsList->add(((e.dir ? std::string("<dir>") : std::to_string(e.size)) + "\t" + e.path).c_str());
+    }
+
+    char title[512];
+    std::snprintf(title, sizeof(title), "%s - %zu entries, %.1f MB unpacked", r->asset.c_str(), r->toc.size(),
+                  static_cast<double>(unpacked) / (1024.0 * 1024.0));
+    gContentsWin->copy_label(title);
+    gContentsWin->show();
+
+    char status[128];
+    if (r->fetched > 0)
+        std::snprintf(status, sizeof(status), "Contents listed (%.0f KB transferred).",
+                      static_cast<double>(r->fetched) / 1024.0);
+    else
+        std::snprintf(status, sizeof(status), "Contents listed from the cache.");
+    set_status(status);
+}
+
+static void on_contents(Fl_Widget *, void *) {
+    const Asset *selected = selected_asset();
+    if (!selected) {
         fl_alert("Select release and asset first.");
         return;
     }
 
-    // If you have filters enabled, use gAssetIndexMap:
-    int real_idx = a_row - 1;
-    if (!gAssetIndexMap.empty()) {
-        if (static_cast<size_t>(a_row - 1) >= gAssetIndexMap.size()) {
-            fl_alert("Invalid selection.");
-            return;
-        }
-        real_idx = gAssetIndexMap[static_cast<size_t>(a_row - 1)];
+    set_status("Fetching contents...");
+    std::thread([asset = *selected] {
+        auto *r = new ContentsResult;
+        r->asset = asset.name;
+        list_asset_contents(asset, r->toc, r->fetched, r->err);
+        Fl::awake(awake_contents_done, r);
+    }).detach();
+}
+
+static void start_download(const bool extract_after) {
+    const Asset *selected = selected_asset();
+    if (!selected) {
+        fl_alert("Select release and asset first.");
+        return;
     }
 
-    const auto &asset = gReleases[r_idx].assets[static_cast<size_t>(real_idx)];
+    const auto &asset = *selected;
 
     // const std::string outDir = pick_output_dir();
     const std::string outDir = gOutDirInput ? gOutDirInput->value() : "";
@@ -841,6 +5887,7 @@ static void start_download(const bool extract_after) {
         outPath += "\\";
     outPath += asset.name;
 
+    cancel_speculative(); // promotes a running prefetch of this asset
     gCancel = false;
     gDoExtract = extract_after;
     gExtractOk = 0;
@@ -850,7 +5897,7 @@ static void start_download(const bool extract_after) {
     gProgress->value(0);
 
     std::thread([asset, outPath] {
-        download_file(asset.url, outPath);
+        download_file(asset, outPath);
     }).detach();
 }
 
@@ -867,6 +5914,695 @@ static void on_cancel(Fl_Widget *, void *) {
     set_status("Cancel requested...");
 }
 
+// ============================================================
+// Command line (headless)
+// ============================================================
+
+// "--name" or "--name=value"; returns false if `arg` is not `--name`.
+static bool match_option(const std::string &arg, const char *name, std::string &value) {
+    const size_t n = std::strlen(name);
+    if (arg.compare(0, n, name) != 0 || (arg.size() > n && arg[n] != '=')) return false;
+    value = arg.size() > n ? arg.substr(n + 1) : std::string();
+    return true;
+}
+
+static void print_usage() {
+    std::fprintf(stderr,
+                 "Usage:\n"
+                 "  MingwDownloader                          start the GUI\n"
+                 "  MingwDownloader list [TEXT]              list catalog assets (name contains TEXT)\n"
+                 "  MingwDownloader contents ASSET|ARCHIVE   list archive entries (7z/zip assets: header only)\n"
+                 "  MingwDownloader download ASSET [--out DIR] [--extract [--in-memory[=MB]] [--also DIR]...]\n"
+                 "                                           --in-memory: keep the archive in RAM (up to MB,\n"
+                 "                                           default 1024) and extract from there\n"
+                 "                                           --also: extract into DIR as well, in the same\n"
+                 "                                           decompression pass (repeatable)\n"
+                 "                                           --keep-unchanged: leave files whose bytes are\n"
+                 "                                           unchanged untouched (mtime included);\n"
+                 "                                           not with --also or --include\n"
+                 "                                           --epoch[=SECONDS]: set every mtime to SECONDS\n"
+                 "                                           (default $SOURCE_DATE_EPOCH)\n"
+                 "                                           --install[=PROFILE]: extract into DIR/<tree>, then\n"
+                 "                                           point the link DIR/PROFILE (default current) at it\n"
+                 "  MingwDownloader download ASSET --include PATTERN... [--out DIR]\n"
+                 "                                           zip assets: fetch and extract only the matching\n"
+                 "                                           entries (glob on path, or file name without '/')\n"
+                 "  MingwDownloader extract-one ARCHIVE|ASSET ENTRY [--out PATH|-]\n"
+                 "                                           extract one file (path or unique file name);\n"
+                 "                                           an asset is fetched into the cache first\n"
+                 "  MingwDownloader diff OLD NEW             added/removed/changed files of two archives\n"
+                 "                                           or assets (size and CRC, nothing extracted)\n"
+                 "  MingwDownloader find PATH|PREFIX*|--crc HEX\n"
+                 "                                           which indexed archives/releases contain a file\n"
+                 "  MingwDownloader switch TREE [PROFILE]    point the profile link next to TREE at TREE\n"
+                 "  MingwDownloader uninstall [--force] TREE...\n"
+                 "                                           remove installed trees (not linked ones);\n"
+                 "                                           --force: also directories not installed here\n"
+                 "  MingwDownloader gc [--keep N] [--dry-run]\n"
+                 "                                           keep the N (default 2) newest installs of each\n"
+                 "                                           variant, remove the rest\n"
+                 "  MingwDownloader export BUNDLE ASSET|PATTERN...\n"
+                 "                                           write the catalog and the archives (downloaded\n"
+                 "                                           into the cache if needed) to one file\n"
+                 "  MingwDownloader import BUNDLE            verify the bundle's archives into the cache and\n"
+                 "                                           use its catalog when offline\n"
+                 "\n"
+                 "Options:\n"
+                 "  --ndjson[=TARGET]      stream progress as NDJSON to stdout (-), stderr, fd:N or a\n"
+                 "                         file (default stdout; stderr for commands printing results)\n"
+                 "  --metrics-file=PATH    write OpenMetrics text to PATH every 5 s and at exit\n"
+                 "  --metrics-port=PORT    serve OpenMetrics on http://127.0.0.1:PORT/\n"
+                 "  --log=LEVEL            trace, debug, info (default), warn, error or off\n"
+                 "                         (MINGWDL_LOG when not given)\n"
+                 "  --log-file=PATH        structured log file (default: <app data>/logs/mingwdl.log)\n");
+}
+
+#ifdef _WIN32
+// GUI-subsystem exe: write to the console of the calling shell, unless
+// stdout has already been redirected to a pipe or file.
+static void attach_parent_console() {
+    if (const HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE); h != nullptr && h != INVALID_HANDLE_VALUE) return;
+    if (!AttachConsole(ATTACH_PARENT_PROCESS)) return;
+
+    FILE *fp = nullptr;
+    freopen_s(&fp, "CONOUT$", "w", stdout);
+    freopen_s(&fp, "CONOUT$", "w", stderr);
+}
+#endif
+
+static bool cli_load_catalog() {
+    progress_phase(Phase::Fetch);
+    CatalogResult result = fetch_catalog();
+
+    for (const auto &f: result.failed) {
+        std::fprintf(stderr, "warning: provider %s failed\n", f.c_str());
+        progress_error("provider " + f + " failed");
+    }
+    if (result.releases.empty()) {
+        std::fprintf(stderr, "error: %s\n", result.parse_error ? "JSON parse error" : "network error");
+        return false;
+    }
+    if (result.offline) std::fprintf(stderr, "warning: offline, using the imported catalog snapshot\n");
+
+    gReleases = std::move(result.releases);
+    build_catalog_index();
+    return true;
+}
+
+static int cli_list(const std::vector<std::string> &args) {
+    const std::string text = args.size() > 1 ? args[1] : "";
+    if (!cli_load_catalog()) return 1;
+
+    for (const auto &rel: gReleases)
+        for (const auto &a: rel.assets)
+            if (text.empty() || has_token(a.name, text.c_str()))
+                std::printf("%s\t%s\t%s\t%lld\n", rel.provider.c_str(), rel.tag.c_str(), a.name.c_str(), a.size);
+    return 0;
+}
+
+// contents ASSET|ARCHIVE: "size<TAB>path" per entry (size -1 for directories)
+static int cli_contents(const std::vector<std::string> &args) {
+    if (args.size() != 2) {
+        print_usage();
+        return 2;
+    }
+
+    std::string err;
+    std::vector<TocEntry> toc;
+    long long fetched = 0;
+    std::error_code ec;
+    bool ok;
+    if (std::filesystem::is_regular_file(args[1], ec)) {
+        ok = load_toc({args[1], {}}, toc, err);
+    } else {
+        if (!cli_load_catalog()) return 1;
+        const auto it = gCatalogIndex.asset_by_name.find(args[1]);
+        if (it == gCatalogIndex.asset_by_name.end()) {
+            std::fprintf(stderr, "error: no such archive or asset: %s\n", args[1].c_str());
+            return 1;
+        }
+        ok = list_asset_contents(gReleases[it->second.first].assets[it->second.second], toc, fetched, err);
+    }
+    if (!ok) {
+        std::fprintf(stderr, "error: %s\n", err.c_str());
+        return 1;
+    }
+
+    for (const auto &e: toc)
+        std::printf("%lld\t%s\n", e.dir ? -1LL : e.size, e.path.c_str());
+    std::fprintf(stderr, "%zu entries, %lld bytes transferred\n", toc.size(), fetched);
+    return 0;
+}
+
+static int cli_download(const std::vector<std::string> &args) {
+    namespace fs = std::filesystem;
+
+    std::string name;
+    std::string outDir = ".";
+    bool extract = false;
+    long long memLimit = 0;
+    std::vector<std::string> includes;
+    std::string v;
+
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "--out" && i + 1 < args.size()) outDir = args[++i];
+        else if (args[i] == "--extract") extract = true;
+        else if (args[i] == "--include" && i + 1 < args.size()) includes.push_back(args[++i]);
+        else if (args[i] == "--also" && i + 1 < args.size()) gFanoutDirs.push_back(args[++i]);
+        else if (args[i] == "--keep-unchanged") gKeepUnchanged = true;
+        else if (match_option(args[i], "--install", v)) {
+            gInstallProfile = v.empty() ? kDefaultProfile : v;
+            extract = true;
+        }
+        else if (match_option(args[i], "--epoch", v)) {
+            if (v.empty() && std::getenv("SOURCE_DATE_EPOCH")) v = std::getenv("SOURCE_DATE_EPOCH");
+            if (v.empty() || v.find_first_not_of("0123456789") != std::string::npos) {
+                std::fprintf(stderr, "error: --epoch needs SECONDS (or SOURCE_DATE_EPOCH)\n");
+                return 2;
+            }
+            gFixedMtime = std::atoll(v.c_str());
+        }
+        else if (match_option(args[i], "--in-memory", v))
+            memLimit = v.empty() ? kDefaultMemoryLimit : std::atoll(v.c_str()) * 1024 * 1024;
+        else if (name.empty()) name = args[i];
+        else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (name.empty()) {
+        print_usage();
+        return 2;
+    }
+    // Only extract_archive_to_dir() compares entries with the files on disk.
+    if (gKeepUnchanged.load() && (!gFanoutDirs.empty() || !includes.empty())) {
+        std::fprintf(stderr, "error: --keep-unchanged cannot be combined with --also or --include\n");
+        return 2;
+    }
+
+    if (!cli_load_catalog()) return 1;
+
+    const auto it = gCatalogIndex.asset_by_name.find(name);
+    if (it == gCatalogIndex.asset_by_name.end()) {
+        std::fprintf(stderr, "error: asset not found: %s\n", name.c_str());
+        progress_error("asset not found: " + name);
+        return 1;
+    }
+    const Asset asset = gReleases[it->second.first].assets[it->second.second];
+
+    std::error_code ec;
+    fs::create_directories(outDir, ec);
+
+    if (!includes.empty()) {
+        // Selected entries only, straight from the remote zip.
+        if (fs::path(asset.name).extension() != ".zip") {
+            std::fprintf(stderr, "error: --include needs a .zip asset\n");
+            progress_error("--include needs a .zip asset");
+            return 1;
+        }
+        progress_phase(Phase::Download, asset.name);
+        std::string err;
+        const int n = fetch_zip_entries(asset, includes, outDir, err);
+        progress_phase(Phase::Done);
+        if (n < 0) std::fprintf(stderr, "error: %s\n", err.c_str());
+        else std::fprintf(stderr, "%d entries, %lld of %lld bytes transferred\n", n, gXferBytes.load(), asset.size);
+        ndjson_emit({{"event", "result"}, {"ok", n >= 0}, {"entries", n}});
+        return n >= 0 ? 0 : 1;
+    }
+
+    if (!gInstallProfile.empty() && !valid_profile_name(gInstallProfile)) {
+        std::fprintf(stderr, "error: bad profile name: %s\n", gInstallProfile.c_str());
+        return 2;
+    }
+    if (!gFanoutDirs.empty() && !extract) {
+        print_usage();
+        return 2;
+    }
+
+    gDoExtract = extract;
+    gExtractOk = 0;
+    gMemoryLimit = memLimit;
+    download_file(asset, (fs::path(outDir) / asset.name).string());
+
+    const bool ok = gLastCurlResult.load() == CURLE_OK && (!extract || gExtractOk.load() == 1);
+    if (!ok)
+        std::fprintf(stderr, "error: %s\n", gLastCurlResult.load() != CURLE_OK
+                                                ? curl_easy_strerror(static_cast<CURLcode>(gLastCurlResult.load()))
+                                                : gExtractErr.c_str());
+    ndjson_emit({{"event", "result"}, {"ok", ok}});
+    return ok ? 0 : 1;
+}
+
+// SOURCE is an archive file, or an asset name (fetched into the cache first).
+static int cli_extract_one(const std::vector<std::string> &args) {
+    namespace fs = std::filesystem;
+
+    std::vector<std::string> pos;
+    std::string out;
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "--out" && i + 1 < args.size()) out = args[++i];
+        else pos.push_back(args[i]);
+    }
+    if (pos.size() != 2) {
+        print_usage();
+        return 2;
+    }
+
+    std::error_code ec;
+    ArchiveSource src{pos[0], {}};
+    if (!fs::is_regular_file(src.path, ec)) {
+        if (!cli_load_catalog()) return 1;
+        const auto it = gCatalogIndex.asset_by_name.find(pos[0]);
+        if (it == gCatalogIndex.asset_by_name.end()) {
+            std::fprintf(stderr, "error: no such archive or asset: %s\n", pos[0].c_str());
+            return 1;
+        }
+        const Asset asset = gReleases[it->second.first].assets[it->second.second];
+        src.path = cache_path_for(asset).string();
+
+        std::lock_guard<std::mutex> lock(gCacheFileMu);
+        if (!cache_has_complete(asset)) {
+            progress_phase(Phase::Download, asset.name);
+            gXferTotal = asset.size;
+            if (const CURLcode res = fill_cache(asset, progress_callback); res != CURLE_OK) {
+                std::fprintf(stderr, "error: %s\n", curl_easy_strerror(res));
+                return 1;
+            }
+        }
+    }
+
+    std::string err;
+    std::vector<TocEntry> toc;
+    if (!load_toc(src, toc, err)) {
+        std::fprintf(stderr, "error: %s\n", err.c_str());
+        return 1;
+    }
+    const int index = find_toc_entry(toc, pos[1], err);
+    if (index < 0) {
+        std::fprintf(stderr, "error: %s\n", err.c_str());
+        return 1;
+    }
+
+    const TocEntry &e = toc[index];
+    progress_phase(Phase::Extract, e.path);
+    const auto t0 = std::chrono::steady_clock::now();
+    bool ok;
+    if (out == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        ok = extract_entry_to(src, index, e.path, stdout, err);
+        std::fflush(stdout);
+    } else {
+        if (out.empty()) out = fs::path(e.path).filename().string();
+        const std::string part = out + ".part";
+        FILE *fp = open_file(part, "wb");
+        ok = fp && extract_entry_to(src, index, e.path, fp, err);
+        if (fp && std::fclose(fp) != 0) ok = false;
+        if (ok) {
+            fs::remove(out, ec);
+            fs::rename(part, out, ec);
+            ok = !ec;
+        } else {
+            fs::remove(part, ec);
+        }
+        if (!fp) err = "cannot create " + part;
+    }
+
+    LOG_EVENT(ok ? LogLevel::Info : LogLevel::Error, "extract_one.done", LogField("archive", src.path),
+              LogField("entry", e.path), LogField("index", index), LogField("size", e.size),
+              LogField("ms", static_cast<long long>(seconds_since(t0) * 1000)));
+    if (!ok) {
+        std::fprintf(stderr, "error: %s\n", err.c_str());
+        progress_error(err);
+    }
+    progress_phase(Phase::Done);
+    ndjson_emit({{"event", "result"}, {"ok", ok}});
+    return ok ? 0 : 1;
+}
+
+// switch TREE [PROFILE]: points the profile link next to TREE at it.
+static int cli_switch(const std::vector<std::string> &args) {
+    namespace fs = std::filesystem;
+    if (args.size() < 2 || args.size() > 3) {
+        print_usage();
+        return 2;
+    }
+    std::error_code ec;
+    const fs::path tree = fs::absolute(args[1], ec).lexically_normal();
+    const fs::path dir = tree.has_filename() ? tree : tree.parent_path();
+    if (!fs::is_directory(dir, ec)) {
+        std::fprintf(stderr, "error: not a directory: %s\n", args[1].c_str());
+        return 1;
+    }
+    // A profile link would point at itself; a .partial tree is half-extracted.
+    if (is_link(dir) || !complete_tree(dir)) {
+        std::fprintf(stderr, "error: not an installed tree: %s\n", args[1].c_str());
+        return 1;
+    }
+    const std::string profile = args.size() == 3 ? args[2] : kDefaultProfile;
+    if (!valid_profile_name(profile)) {
+        std::fprintf(stderr, "error: bad profile name: %s\n", profile.c_str());
+        return 2;
+    }
+    std::string err;
+    if (!switch_profile(dir.parent_path(), profile, dir, err)) {
+        std::fprintf(stderr, "error: %s\n", err.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "%s -> %s\n", (dir.parent_path() / profile).string().c_str(), dir.filename().string().c_str());
+    return 0;
+}
+
+// Moves each tree to the trash, then deletes them all in parallel. Only trees
+// this tool installed (marker or installs.json record) unless `force`.
+static int remove_trees(const std::vector<std::string> &trees, const bool dryRun, const bool force = false) {
+    namespace fs = std::filesystem;
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<fs::path> trashed;
+    std::deque<CacheLock> locks; // one per trashed entry, held until it is deleted
+    std::vector<std::string> removed;
+    int failures = 0;
+
+    for (const auto &t: trees) {
+        std::error_code ec;
+        const fs::path tree = fs::absolute(t, ec).lexically_normal();
+        const fs::path dir = tree.has_filename() ? tree : tree.parent_path();
+        if (!fs::is_directory(dir, ec) || is_link(dir)) {
+            std::fprintf(stderr, "error: not an installed tree: %s\n", t.c_str());
+            ++failures;
+            continue;
+        }
+        if (!force && !complete_tree(dir)) {
+            std::fprintf(stderr, "error: %s was not installed by this tool (--force removes it anyway)\n",
+                         dir.string().c_str());
+            ++failures;
+            continue;
+        }
+        if (const auto links = links_to_tree(dir); !links.empty()) {
+            std::fprintf(stderr, "error: %s is in use by profile %s; switch it first\n", dir.string().c_str(),
+                         links.front().c_str());
+            ++failures;
+            continue;
+        }
+        if (dryRun) {
+            std::printf("would remove %s\n", dir.string().c_str());
+            continue;
+        }
+        fs::path to;
+        if (std::string err; !move_to_trash(dir, to, locks.emplace_back(), err)) {
+            std::fprintf(stderr, "error: %s\n", err.c_str());
+            locks.pop_back();
+            ++failures;
+            continue;
+        }
+        std::printf("removed %s\n", dir.string().c_str());
+        trashed.push_back(to);
+        removed.push_back(dir.string());
+    }
+    if (!removed.empty()) forget_installs(removed);
+    const double renameSecs = seconds_since(t0);
+
+    DeleteStats stats;
+    for (size_t i = 0; i < trashed.size(); ++i) purge_trash_entry(trashed[i], locks[i], stats);
+
+    // Leftovers of interrupted runs in the same trash directories: entries
+    // whose lock nobody holds. A concurrent run keeps its own locked.
+    std::vector<fs::path> trashDirs;
+    for (const auto &t: trashed)
+        if (std::find(trashDirs.begin(), trashDirs.end(), t.parent_path()) == trashDirs.end())
+            trashDirs.push_back(t.parent_path());
+    for (const auto &trash: trashDirs) {
+        std::error_code ec;
+        std::vector<fs::path> entries;
+        for (fs::directory_iterator it(trash, ec), end; !ec && it != end; it.increment(ec))
+            if (it->path().extension() != ".lock") entries.push_back(it->path());
+        for (const auto &e: entries)
+            if (CacheLock lock; lock.try_acquire(trash_lock_path(e))) purge_trash_entry(e, lock, stats);
+    }
+    for (const auto &t: trashed) {
+        std::error_code ec;
+        fs::remove(t.parent_path(), ec); // the trash itself, once empty
+    }
+    const double secs = seconds_since(t0);
+    LOG_EVENT(LogLevel::Info, "gc.done", LogField("trees", removed.size()), LogField("files", stats.files.load()),
+              LogField("bytes", stats.bytes.load()), LogField("failed", stats.failed.load()),
+              LogField("ms", static_cast<long long>(secs * 1000)));
+    if (!removed.empty())
+        std::fprintf(stderr, "%zu trees gone in %.0f ms; reclaimed %.1f MB in %lld files (%.1f s)%s\n",
+                     removed.size(), renameSecs * 1000, static_cast<double>(stats.bytes.load()) / 1e6,
+                     stats.files.load(), secs, stats.failed.load() ? ", some entries could not be deleted" : "");
+    return failures || stats.failed.load() ? 1 : 0;
+}
+
+// uninstall [--force] TREE...
+static int cli_uninstall(const std::vector<std::string> &args) {
+    std::vector<std::string> trees;
+    bool force = false;
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "--force") force = true;
+        else trees.push_back(args[i]);
+    }
+    if (trees.empty()) {
+        print_usage();
+        return 2;
+    }
+    return remove_trees(trees, false, force);
+}
+
+// gc [--keep N] [--dry-run]: keeps the N newest installs of each variant.
+static int cli_gc(const std::vector<std::string> &args) {
+    int keep = 2;
+    bool dryRun = false;
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "--keep" && i + 1 < args.size()) keep = std::atoi(args[++i].c_str());
+        else if (args[i] == "--dry-run") dryRun = true;
+        else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (keep < 1) {
+        std::fprintf(stderr, "error: --keep must be at least 1\n");
+        return 2;
+    }
+    const std::vector<std::string> trees = gc_candidates(keep);
+    if (trees.empty()) {
+        std::fprintf(stderr, "nothing to remove\n");
+        return 0;
+    }
+    return remove_trees(trees, dryRun);
+}
+
+// diff OLD NEW (archives or assets): "+|-|M|?<TAB>path<TAB>old size<TAB>new size"
+static int cli_diff(const std::vector<std::string> &args) {
+    if (args.size() != 3) {
+        print_usage();
+        return 2;
+    }
+    std::error_code ec;
+    if ((!std::filesystem::is_regular_file(args[1], ec) || !std::filesystem::is_regular_file(args[2], ec))
+        && !cli_load_catalog())
+        return 1;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<TocEntry> older, newer;
+    std::string err;
+    if (!diff_side_toc(args[1], older, err) || !diff_side_toc(args[2], newer, err)) {
+        std::fprintf(stderr, "error: %s\n", err.c_str());
+        return 1;
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    sort_toc_for_diff(older);
+    sort_toc_for_diff(newer);
+    const std::vector<DiffLine> lines = diff_tocs(older, newer);
+    const double joinSecs = seconds_since(t1);
+
+    size_t counts[4] = {};
+    long long bytes[4] = {};
+    for (const auto &l: lines) {
+        const int k = l.kind == '+' ? 0 : l.kind == '-' ? 1 : l.kind == 'M' ? 2 : 3;
+        ++counts[k];
+        bytes[k] += l.newSize - l.oldSize;
+        std::printf("%c\t%s\t%lld\t%lld\n", l.kind, l.path.c_str(), l.oldSize, l.newSize);
+    }
+    std::fprintf(stderr,
+                 "%zu added (%+lld bytes), %zu removed (%+lld bytes), %zu changed (%+lld bytes), "
+                 "%zu same-size without CRC; %zu vs %zu files, join %.1f ms, total %.0f ms\n",
+                 counts[0], bytes[0], counts[1], bytes[1], counts[2], bytes[2], counts[3], older.size(),
+                 newer.size(), joinSecs * 1000, seconds_since(t0) * 1000);
+    return 0;
+}
+
+// find PATH | PREFIX* | --crc HEX: "path<TAB>release<TAB>published<TAB>archive<TAB>size<TAB>crc",
+// oldest release first.
+static int cli_find(const std::vector<std::string> &args) {
+    if (args.size() < 2 || args.size() > 3 || (args[1] == "--crc") != (args.size() == 3)) {
+        print_usage();
+        return 2;
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    ContentsIndex ix;
+    if (!load_index(ix)) {
+        std::fprintf(stderr, "error: no contents index yet (%s)\n", index_path().string().c_str());
+        return 1;
+    }
+    const double loadSecs = seconds_since(t0);
+
+    const auto t1 = std::chrono::steady_clock::now();
+    std::vector<IndexHit> hits;
+    if (args[1] == "--crc") {
+        std::string crc = args[2];
+        std::transform(crc.begin(), crc.end(), crc.begin(), [](unsigned char c) { return std::tolower(c); });
+        hits = index_lookup_crc(ix, crc);
+    } else {
+        std::string key = args[1];
+        const bool prefix = !key.empty() && key.back() == '*';
+        if (prefix) key.pop_back();
+        hits = index_lookup(ix, key, prefix);
+    }
+    const double querySecs = seconds_since(t1);
+
+    std::stable_sort(hits.begin(), hits.end(), [](const IndexHit &a, const IndexHit &b) {
+        return a.path != b.path ? a.path < b.path : a.archive->published < b.archive->published;
+    });
+    for (const auto &h: hits)
+        std::printf("%s\t%s\t%s\t%s\t%lld\t%s\n", h.path.c_str(), h.archive->release.c_str(),
+                    h.archive->published.c_str(), h.archive->name.c_str(), h.size, h.crc.c_str());
+    std::fprintf(stderr, "%zu hits in %.3f ms (%zu paths, %zu archives; loaded in %.0f ms)\n", hits.size(),
+                 querySecs * 1000, ix.paths.size(), ix.archives.size(), loadSecs * 1000);
+    return 0;
+}
+
+// export BUNDLE ASSET|PATTERN...: archives not yet cached are downloaded first.
+static int cli_export(const std::vector<std::string> &args) {
+    if (args.size() < 3) {
+        print_usage();
+        return 2;
+    }
+    if (!cli_load_catalog()) return 1;
+
+    std::vector<Asset> assets;
+    for (size_t i = 2; i < args.size(); ++i) {
+        const size_t before = assets.size();
+        for (const auto &rel: gReleases)
+            for (const auto &a: rel.assets)
+                if (glob_match(args[i], a.name)
+                    && std::none_of(assets.begin(), assets.end(), [&](const Asset &x) { return x.name == a.name; }))
+                    assets.push_back(a);
+        if (assets.size() == before) {
+            std::fprintf(stderr, "error: no asset matches %s\n", args[i].c_str());
+            return 1;
+        }
+    }
+
+    for (const auto &a: assets) {
+        std::lock_guard<std::mutex> lock(gCacheFileMu);
+        if (cache_has_complete(a)) continue;
+        progress_phase(Phase::Download, a.name);
+        gXferTotal = a.size;
+        if (const CURLcode res = fill_cache(a, progress_callback); res != CURLE_OK) {
+            std::fprintf(stderr, "error: %s: %s\n", a.name.c_str(), curl_easy_strerror(res));
+            return 1;
+        }
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    if (std::string err; !write_bundle(args[1], assets, err)) {
+        std::fprintf(stderr, "error: %s\n", err.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "wrote %s: %zu archives in %.1f s\n", args[1].c_str(), assets.size(), seconds_since(t0));
+    return 0;
+}
+
+// import BUNDLE: verified archives go into the cache, the catalog into the snapshot.
+static int cli_import(const std::vector<std::string> &args) {
+    if (args.size() != 2) {
+        print_usage();
+        return 2;
+    }
+
+    json index;
+    long long indexAt = 0;
+    if (std::string err; !read_bundle_index(args[1], index, indexAt, err)) {
+        std::fprintf(stderr, "error: %s\n", err.c_str());
+        return 1;
+    }
+    // Published digests by asset name, from the bundle's catalog.
+    std::map<std::string, std::string> published;
+    if (std::vector<Release> releases; catalog_from_json(index.value("catalog", json::array()), releases))
+        for (const auto &rel: releases)
+            for (const auto &a: rel.assets)
+                if (!a.sha256.empty()) published[a.name] = lower_hex(a.sha256);
+
+    std::vector<BundleItem> items;
+    for (const auto &a: index.value("archives", json::array())) {
+        BundleItem item;
+        item.name = a.value("name", "");
+        item.size = a.value("size", 0LL);
+        item.offset = a.value("offset", 0LL);
+        item.crc = a.value("crc32", "");
+        item.sha256 = lower_hex(a.value("sha256", ""));
+        if (item.name.empty() || item.name.find_first_of("/\\") != std::string::npos || item.name[0] == '.') {
+            std::fprintf(stderr, "error: bad archive name in index: %s\n", item.name.c_str());
+            return 1;
+        }
+        if (const auto it = published.find(item.name); it != published.end()) {
+            if (item.sha256.empty()) item.sha256 = it->second;
+            else if (item.sha256 != it->second) item.error = "index and catalog disagree on the SHA-256";
+        }
+        if (item.offset < 0 || item.size < 0 || item.size > indexAt - item.offset)
+            item.error = "range runs past the archive data";
+        items.push_back(std::move(item));
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    import_bundle_archives(args[1], items);
+    const double secs = seconds_since(t0);
+
+    int failures = 0, imported = 0, cloned = 0;
+    long long bytes = 0;
+    for (const auto &item: items) {
+        if (!item.error.empty()) {
+            std::fprintf(stderr, "error: %s: %s\n", item.name.c_str(), item.error.c_str());
+            ++failures;
+            continue;
+        }
+        std::printf("%s\t%s\n", item.verified ? "imported" : "cached", item.name.c_str());
+        if (!item.verified) continue;
+        ++imported;
+        bytes += item.size;
+        cloned += item.cloned;
+    }
+    if (!merge_catalog_snapshot(index.value("catalog", json::array()))) {
+        std::fprintf(stderr, "error: cannot update the catalog snapshot\n");
+        ++failures;
+    }
+    std::fprintf(stderr, "%d archives (%.1f MB) verified and imported in %.1f s (%d by kernel copy); bundle of %s\n",
+                 imported, static_cast<double>(bytes) / 1e6, secs, cloned, index.value("created", "?").c_str());
+    return failures ? 1 : 0;
+}
+
+static int run_cli(const std::vector<std::string> &args) {
+    const std::string &cmd = args[0];
+    if (cmd == "list") return cli_list(args);
+    if (cmd == "download") return cli_download(args);
+    if (cmd == "extract-one") return cli_extract_one(args);
+    if (cmd == "contents") return cli_contents(args);
+    if (cmd == "find") return cli_find(args);
+    if (cmd == "diff") return cli_diff(args);
+    if (cmd == "switch") return cli_switch(args);
+    if (cmd == "uninstall") return cli_uninstall(args);
+    if (cmd == "gc") return cli_gc(args);
+    if (cmd == "export") return cli_export(args);
+    if (cmd == "import") return cli_import(args);
+
+    print_usage();
+    return 2;
+}
+
 // ============================================================
 // Main / UI layout
 // ============================================================
@@ -878,12 +6614,118 @@ static void center_window(Fl_Window &win) {
                  sy + (sh - win.h()) / 2);
 }
 
-int main() {
+// Options valid in both GUI and command-line mode.
+struct GlobalOptions {
+    bool ndjson = false;
+    std::string ndjson_target;
+    std::string metrics_file;
+    int metrics_port = 0;
+    std::string log_level;
+    std::string log_file;
+};
+
+// Moves global options out of `args`, leaving the command and its arguments.
+static GlobalOptions take_global_options(std::vector<std::string> &args) {
+    GlobalOptions o;
+    std::vector<std::string> rest;
+    std::string v;
+
+    for (const auto &a: args) {
+        if (match_option(a, "--ndjson", v)) {
+            o.ndjson = true;
+            o.ndjson_target = v; // empty: resolved by ndjson_default_target
+        } else if (match_option(a, "--metrics-file", v)) {
+            o.metrics_file = v;
+        } else if (match_option(a, "--metrics-port", v)) {
+            o.metrics_port = std::atoi(v.c_str());
+        } else if (match_option(a, "--log", v)) {
+            o.log_level = v;
+        } else if (match_option(a, "--log-file", v)) {
+            o.log_file = v;
+        } else {
+            rest.push_back(a);
+        }
+    }
+
+    if (o.log_level.empty()) {
+        const char *env = std::getenv("MINGWDL_LOG");
+        o.log_level = env && *env ? env : "info";
+    }
+
+    args.swap(rest);
+    return o;
+}
+
+// Commands that print their results (or, extract-one --out -, file data)
+// on stdout: NDJSON goes to stderr by default and may not share stdout.
+static bool command_writes_stdout(const std::vector<std::string> &args) {
+    if (args.empty()) return false;
+    const std::string &cmd = args[0];
+    if (cmd == "extract-one")
+        for (size_t i = 1; i + 1 < args.size(); ++i)
+            if (args[i] == "--out" && args[i + 1] == "-") return true;
+    return cmd == "list" || cmd == "contents" || cmd == "find" || cmd == "diff" || cmd == "import"
+           || cmd == "uninstall" || cmd == "gc";
+}
+
+static void shutdown_services() {
+    gInventoryStop = true;
+    if (gInventoryThread.joinable()) gInventoryThread.join();
+    ndjson_stop();
+    metrics_stop();
+    net_cleanup();
+    curl_global_cleanup();
+    log_stop();
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    const GlobalOptions opts = take_global_options(args);
+
+#ifdef _WIN32
+    if (opts.ndjson || !args.empty()) attach_parent_console();
+#endif
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    net_init();
+    load_provider_selection();
+
+    const LogLevel logLevel = parse_log_level(opts.log_level);
+    if (logLevel == LogLevel::Off && opts.log_level != "off")
+        std::fprintf(stderr, "warning: unknown log level '%s', logging disabled\n", opts.log_level.c_str());
+    log_start(logLevel, opts.log_file);
+    LOG_EVENT(LogLevel::Info, "app.start", LogField("curl", curl_version()),
+              LogField("mode", args.empty() ? "gui" : args[0]));
+
+    const bool stdoutTaken = command_writes_stdout(args);
+    const std::string ndjsonTarget = !opts.ndjson_target.empty() ? opts.ndjson_target : stdoutTaken ? "stderr" : "-";
+    if (opts.ndjson && ndjsonTarget == "-" && stdoutTaken) {
+        std::fprintf(stderr, "error: %s writes its output to stdout; use --ndjson=stderr, fd:N or a file\n",
+                     args[0].c_str());
+        shutdown_services();
+        return 2;
+    }
+    if (opts.ndjson && !ndjson_start(ndjsonTarget)) {
+        std::fprintf(stderr, "error: cannot open NDJSON target: %s\n", ndjsonTarget.c_str());
+        shutdown_services();
+        return 2;
+    }
+    if (!opts.metrics_file.empty())
+        metrics_start_file(opts.metrics_file);
+    if (opts.metrics_port > 0 && !metrics_start_http(opts.metrics_port))
+        std::fprintf(stderr, "warning: cannot listen on 127.0.0.1:%d\n", opts.metrics_port);
+
+    if (!args.empty()) {
+        gHeadless = true;
+        const int rc = run_cli(args);
+        shutdown_services();
+        return rc;
+    }
+
     Fl::scheme("gtk+");
     Fl::set_color(FL_BACKGROUND_COLOR, 245, 245, 245);
 
     Fl::lock();
-    curl_global_init(CURL_GLOBAL_DEFAULT);
 
     constexpr int W = 860;
     constexpr int H = 520;
@@ -907,14 +6749,23 @@ int main() {
     constexpr int releaseLabelW = 60;
     constexpr int releaseX = x0 + releaseLabelW;
     constexpr int releaseY = y0;
-    constexpr int releaseW = W - M - releaseX - GAP - BTN_W;
+    constexpr int releaseW = 380;
     constexpr int releaseH = ROW1_H;
 
     gRelease = new Fl_Choice(releaseX, releaseY, releaseW, releaseH, "Release:");
     gRelease->align(FL_ALIGN_LEFT);
     gRelease->callback(on_release_changed);
 
-    auto *btnRefresh = new Fl_Button(releaseX + releaseW + GAP, releaseY, BTN_W, releaseH, "Refresh");
+    constexpr int searchLabelW = 56;
+    constexpr int searchX = releaseX + releaseW + GAP + searchLabelW;
+    constexpr int searchW = W - M - BTN_W - GAP - searchX;
+
+    gSearch = new Fl_Input(searchX, releaseY, searchW, releaseH, "Search:");
+    gSearch->align(FL_ALIGN_LEFT);
+    gSearch->when(FL_WHEN_CHANGED);
+    gSearch->callback(on_search_changed);
+
+    auto *btnRefresh = new Fl_Button(W - M - BTN_W, releaseY, BTN_W, releaseH, "Refresh");
     btnRefresh->callback(on_refresh);
 
     // =========================
@@ -961,6 +6812,7 @@ int main() {
     // gAssets->textfont(FL_HELVETICA);
     gAssets->textfont(FL_COURIER);
     gAssets->textsize(16);
+    gAssets->callback(on_asset_selected);
 
     // =========================
     // Output folder row (NEW)
@@ -984,17 +6836,26 @@ int main() {
     constexpr int bottomY = outRowY + outRowH + 10;
     constexpr int btnH = 30;
 
-    auto *btnDownload = new Fl_Button(x0, bottomY, 160, btnH, "Download");
+    auto *btnDownload = new Fl_Button(x0, bottomY, 110, btnH, "Download");
     btnDownload->callback(on_download);
 
-    auto *btnDownloadExtract = new Fl_Button(x0 + 160 + GAP, bottomY, 180, btnH, "Download + Extract");
+    auto *btnDownloadExtract = new Fl_Button(x0 + 110 + GAP, bottomY, 150, btnH, "Download + Extract");
     btnDownloadExtract->callback(on_download_extract);
 
-    auto *btnCancel = new Fl_Button(x0 + 160 + GAP + 180 + GAP, bottomY, 90, btnH, "Cancel");
+    auto *btnContents = new Fl_Button(x0 + 110 + GAP + 150 + GAP, bottomY, 90, btnH, "Contents");
+    btnContents->tooltip("List the files in the selected asset (7z/zip: fetches only the archive header)");
+    btnContents->callback(on_contents);
+
+    auto *btnCancel = new Fl_Button(x0 + 110 + GAP + 150 + GAP + 90 + GAP, bottomY, 80, btnH, "Cancel");
     btnCancel->callback(on_cancel);
 
+    auto *chkPrefetch = new Fl_Check_Button(x0 + 110 + GAP + 150 + GAP + 90 + GAP + 80 + GAP, bottomY, 90, btnH,
+                                            "Prefetch");
+    chkPrefetch->tooltip("Download the selected asset into the local cache in the background (rate-limited)");
+    chkPrefetch->callback(on_prefetch_toggled);
+
     // progress starts after buttons
-    constexpr int progX = x0 + 160 + GAP + 180 + GAP + 90 + GAP;
+    constexpr int progX = x0 + 110 + GAP + 150 + GAP + 90 + GAP + 80 + GAP + 90 + GAP;
     constexpr int progW = W - M - progX;
 
     gProgress = new Fl_Progress(progX, bottomY, progW, btnH);
@@ -1022,7 +6883,9 @@ int main() {
     }
 #endif
 
+    Fl::add_timeout(kInventoryPoll, inventory_timer_cb);
+
     const int result = Fl::run();
-    curl_global_cleanup();
+    shutdown_services();
     return result;
 }
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Shared-cache stress test: N downloader processes, one fetch.
+
+Starts a loopback HTTP server (Range support, throttled so the processes
+overlap), points N copies of the downloader at one MINGWDL_CACHE and checks
+that the archive body was sent once and that every process ended up with an
+intact copy.
+
+    cache_stress.py PATH_TO_MingwDownloader [--processes N] [--size MB]
+"""
+
+import argparse
+import hashlib
+import http.server
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+ASSET = "stress-archive.7z"
+CHUNK = 64 * 1024
+THROTTLE = 0.002  # s per chunk: ~32 MB/s, long enough for every process to start
+
+
+class Server(http.server.ThreadingHTTPServer):
+    daemon_threads = True
+
+    def __init__(self, data):
+        super().__init__(("127.0.0.1", 0), Handler)
+        self.data = data
+        self.lock = threading.Lock()
+        self.body_bytes = 0  # archive bytes sent, all requests
+        self.requests = 0
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, *args):
+        pass
+
+    def do_GET(self):
+        data = self.server.data
+        if self.path != "/" + ASSET:
+            self.send_response(404)
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+            return
+
+        first, last = 0, len(data) - 1
+        rng = self.headers.get("Range", "")
+        if rng.startswith("bytes="):
+            a, _, b = rng[6:].partition("-")
+            first = int(a) if a else len(data) - int(b)
+            last = int(b) if a and b else len(data) - 1
+            self.send_response(206)
+            self.send_header("Content-Range", "bytes %d-%d/%d" % (first, last, len(data)))
+        else:
+            self.send_response(200)
+        self.send_header("Content-Length", str(last - first + 1))
+        self.end_headers()
+
+        with self.server.lock:
+            self.server.requests += 1
+        for at in range(first, last + 1, CHUNK):
+            piece = data[at:min(at + CHUNK, last + 1)]
+            try:
+                self.wfile.write(piece)
+            except OSError:
+                return
+            with self.server.lock:
+                self.server.body_bytes += len(piece)
+            time.sleep(THROTTLE)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("exe")
+    ap.add_argument("--processes", type=int, default=12)
+    ap.add_argument("--size", type=int, default=24, help="archive size in MB")
+    args = ap.parse_args()
+
+    data = os.urandom(args.size * 1024 * 1024)
+    digest = hashlib.sha256(data).hexdigest()
+    server = Server(data)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    url = "http://127.0.0.1:%d/%s" % (server.server_address[1], ASSET)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        cache = os.path.join(tmp, "cache")
+        os.makedirs(cache)
+        procs = []
+        for i in range(args.processes):
+            home = os.path.join(tmp, "home%d" % i)
+            out = os.path.join(tmp, "out%d" % i)
+            os.makedirs(home)
+            os.makedirs(out)
+            # No provider is reachable: the catalog comes from the snapshot.
+            with open(os.path.join(home, "catalog.json"), "w") as f:
+                json.dump([{
+                    "provider": "niXman", "tag": "stress", "published_at": "2000-01-01T00:00:00Z",
+                    "assets": [{"name": ASSET, "size": len(data), "url": url, "sha256": ""}],
+                }], f)
+            env = dict(os.environ, MINGWDL_HOME=home, MINGWDL_CACHE=cache, MINGWDL_PROVIDERS="none")
+            procs.append((out, subprocess.Popen(
+                [args.exe, "download", ASSET, "--out", out], env=env,
+                stdout=subprocess.PIPE, stderr=subprocess.STDOUT)))
+
+        failures = []
+        for i, (out, p) in enumerate(procs):
+            log = p.communicate(timeout=600)[0].decode(errors="replace")
+            path = os.path.join(out, ASSET)
+            if p.returncode != 0:
+                failures.append("process %d exited with %d:\n%s" % (i, p.returncode, log))
+            elif not os.path.isfile(path):
+                failures.append("process %d: %s missing" % (i, path))
+            else:
+                with open(path, "rb") as f:
+                    if hashlib.sha256(f.read()).hexdigest() != digest:
+                        failures.append("process %d: %s differs from the served archive" % (i, path))
+
+        cached = os.path.join(cache, "niXman", "stress", ASSET)
+        if not os.path.isfile(cached):
+            failures.append("no archive in the shared cache")
+        else:
+            with open(cached, "rb") as f:
+                if hashlib.sha256(f.read()).hexdigest() != digest:
+                    failures.append("cached archive differs from the served archive")
+        if os.path.exists(cached + ".part"):
+            failures.append(".part left in the cache")
+        if server.body_bytes != len(data):
+            failures.append("served %d archive bytes in %d requests, expected one fetch of %d"
+                            % (server.body_bytes, server.requests, len(data)))
+
+    server.shutdown()
+    print("%d processes, %d request(s), %d of %d bytes served"
+          % (args.processes, server.requests, server.body_bytes, len(data)))
+    for f in failures:
+        print("FAIL: " + f, file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())